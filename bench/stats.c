@@ -0,0 +1,118 @@
+#include "../src/component.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// compares the scalar stat updates against the batch kernels in stats_batch.c over one big array of shields, the worst case
+// in the game since it has the most fields. prints one line per path:
+//   <path> <entities> <iterations> <ns per entity>
+#define BENCH_ENTITIES   100000
+#define BENCH_ITERATIONS 200
+#define BENCH_FRAME_TIME (1.0f / 60.0f)
+
+// live and gv step by stride bytes so they can point into a component array, delta, max and out are packed
+#define STATS_BATCH 64
+
+void LiveValue_update_batch(uint32_t count, LiveValue * live, size_t stride, const alias_R * delta, const alias_R * max, alias_R frame_time, alias_R time);
+void GameValue_get_batch(uint32_t count, const GameValue * gv, size_t stride, alias_R * out);
+
+static void _fill(struct Shield * shields, uint32_t count) {
+  srand(1);
+  for(uint32_t i = 0; i < count; i++) {
+    struct Shield * s = &shields[i];
+    alias_memory_clear(s, sizeof(*s));
+    s->live = LIVE_VALUE((alias_R)(rand() % 200) - 50);
+    s->live.damage = rand() % 4 == 0 ? (alias_R)(rand() % 20) : alias_R_ZERO;
+    s->max = GAME_VALUE(100);
+    s->regen_per_second = GAME_VALUE((alias_R)(rand() % 10));
+    s->regen_percent_per_second = GAME_VALUE(0.01f);
+    s->recharge_delay = GAME_VALUE(2);
+    s->recharge_per_second = GAME_VALUE(5);
+    s->recharge_percentage_per_second = GAME_VALUE(0.05f);
+    s->recharge_power_per_second = GAME_VALUE(1);
+    if(i % 3 == 0) {
+      GameValue_increase(&s->max, 0.5f);
+    }
+  }
+}
+
+static void _scalar(struct Shield * shields, uint32_t count, alias_R time) {
+  for(uint32_t i = 0; i < count; i++) {
+    struct Shield * s = &shields[i];
+    alias_R max = GameValue_get(&s->max);
+    alias_R delta = GameValue_get(&s->regen_per_second) + max * GameValue_get(&s->regen_percent_per_second);
+    s->recharging = s->live.current < max && time > s->live.last_damage_time + GameValue_get(&s->recharge_delay);
+    if(s->recharging) {
+      delta += GameValue_get(&s->recharge_per_second) + max * GameValue_get(&s->recharge_percentage_per_second);
+    }
+    LiveValue_update_at(&s->live, delta, max, BENCH_FRAME_TIME, time);
+  }
+}
+
+// the same as shield_system
+static void _batch(struct Shield * shields, uint32_t count, alias_R time) {
+  alias_R max[STATS_BATCH], regen[STATS_BATCH], regen_percent[STATS_BATCH], delay[STATS_BATCH], delta[STATS_BATCH];
+  alias_R recharge[STATS_BATCH], recharge_percent[STATS_BATCH];
+  for(uint32_t start = 0; start < count; start += STATS_BATCH) {
+    uint32_t n = alias_min(count - start, STATS_BATCH);
+    struct Shield * s = shields + start;
+    GameValue_get_batch(n, &s->max, sizeof(*s), max);
+    GameValue_get_batch(n, &s->regen_per_second, sizeof(*s), regen);
+    GameValue_get_batch(n, &s->regen_percent_per_second, sizeof(*s), regen_percent);
+    GameValue_get_batch(n, &s->recharge_delay, sizeof(*s), delay);
+    GameValue_get_batch(n, &s->recharge_per_second, sizeof(*s), recharge);
+    GameValue_get_batch(n, &s->recharge_percentage_per_second, sizeof(*s), recharge_percent);
+    for(uint32_t i = 0; i < n; i++) {
+      s[i].recharging = s[i].live.current < max[i] && time > s[i].live.last_damage_time + delay[i];
+      delta[i] = regen[i] + max[i] * regen_percent[i];
+      if(s[i].recharging) {
+        delta[i] += recharge[i] + max[i] * recharge_percent[i];
+      }
+    }
+    LiveValue_update_batch(n, &s->live, sizeof(*s), delta, max, BENCH_FRAME_TIME, time);
+  }
+}
+
+static uint64_t _run(const char * name, void (*f)(struct Shield *, uint32_t, alias_R), struct Shield * shields) {
+  _fill(shields, BENCH_ENTITIES);
+  uint64_t start = uv_hrtime();
+  for(uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+    f(shields, BENCH_ENTITIES, i * BENCH_FRAME_TIME);
+  }
+  uint64_t elapsed = uv_hrtime() - start;
+  printf("%s %u %u %.3f\n", name, BENCH_ENTITIES, BENCH_ITERATIONS, (double)elapsed / ((double)BENCH_ENTITIES * BENCH_ITERATIONS));
+  return elapsed;
+}
+
+static bool _same(alias_R a, alias_R b) {
+  return a == b || (alias_R_isnan(a) && alias_R_isnan(b)) || fabsf(a - b) <= 1e-4f * alias_max(fabsf(a), alias_R_ONE);
+}
+
+int main(int argc, char * argv[]) {
+  (void)argc;
+  (void)argv;
+
+  size_t size = sizeof(struct Shield) * BENCH_ENTITIES;
+  struct Shield * expected = alias_malloc(alias_default_MemoryCB(), size, alignof(struct Shield));
+  struct Shield * actual = alias_malloc(alias_default_MemoryCB(), size, alignof(struct Shield));
+
+  uint64_t scalar = _run("scalar", _scalar, expected);
+  uint64_t batch = _run("batch", _batch, actual);
+
+  uint32_t mismatches = 0;
+  for(uint32_t i = 0; i < BENCH_ENTITIES; i++) {
+    const LiveValue * e = &expected[i].live, * a = &actual[i].live;
+    mismatches += !(_same(e->current, a->current) && _same(e->depleted_time, a->depleted_time)
+                 && _same(e->full_time, a->full_time) && _same(e->last_damage_time, a->last_damage_time)
+                 && expected[i].recharging == actual[i].recharging
+                 );
+  }
+
+  printf("speedup %.2f\nmismatches %u\n", (double)scalar / (double)batch, mismatches);
+
+  alias_free(alias_default_MemoryCB(), expected, size, alignof(struct Shield));
+  alias_free(alias_default_MemoryCB(), actual, size, alignof(struct Shield));
+
+  return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#include "../src/component.h"
+
+#include <string.h>
+
+// batch versions of the stat updates, only built into alias_town_stats_bench. the components are arrays of structures
+// and too wide for these to beat the scalar versions, so the game does not use them. a batch loads the leading four
+// fields of four neighbours and transposes them into one vector per field, does the math across all lanes at once and
+// transposes back. clamps and the depleted/full timestamps are selected with masks instead of branches.
+//
+// sse handles 4 lanes, avx 8 when the compiler targets it (-mavx). anything else uses the scalar versions. lanes past
+// the last full vector go through the scalar versions as well
+#if defined(__SSE2__)
+#include <immintrin.h>
+
+_Static_assert(sizeof(alias_R) == sizeof(float), "stat kernels are written for a float alias_R");
+_Static_assert(sizeof(LiveValue) == 5 * sizeof(float) && sizeof(GameValue) == 5 * sizeof(float), "stat kernels expect five float fields");
+
+#if defined(__AVX__)
+#define STATS_LANES 8
+#define STATS_EACH_LANE(X, ...) X(0, __VA_ARGS__), X(1, __VA_ARGS__), X(2, __VA_ARGS__), X(3, __VA_ARGS__), \
+                                X(4, __VA_ARGS__), X(5, __VA_ARGS__), X(6, __VA_ARGS__), X(7, __VA_ARGS__)
+#else
+#define STATS_LANES 4
+#define STATS_EACH_LANE(X, ...) X(0, __VA_ARGS__), X(1, __VA_ARGS__), X(2, __VA_ARGS__), X(3, __VA_ARGS__)
+#endif
+
+typedef float StatsVector __attribute__((vector_size(STATS_LANES * sizeof(float))));
+typedef int32_t StatsMask __attribute__((vector_size(STATS_LANES * sizeof(int32_t))));
+
+static inline StatsVector _select(StatsMask mask, StatsVector yes, StatsVector no) {
+  return (StatsVector)(((StatsMask)yes & mask) | ((StatsMask)no & ~mask));
+}
+
+#define STATS_AT(BASE, STRIDE, LANE) ((uint8_t *)(BASE) + (STRIDE) * (LANE))
+
+// the fifth field does not fit the transpose and is built from one initializer, filling a vector lane by lane goes
+// through the stack and stalls on the reload
+#define STATS_LANE_FIELD(LANE, BASE, STRIDE, TYPE, FIELD) ((const TYPE *)STATS_AT(BASE, STRIDE, LANE))->FIELD
+#define STATS_GATHER(BASE, STRIDE, TYPE, FIELD) (StatsVector) { STATS_EACH_LANE(STATS_LANE_FIELD, BASE, STRIDE, TYPE, FIELD) }
+
+#define STATS_SCATTER(VECTOR, BASE, STRIDE, TYPE, FIELD) \
+  for(uint32_t __lane = 0; __lane < STATS_LANES; __lane++) { \
+    ((TYPE *)STATS_AT(BASE, STRIDE, __lane))->FIELD = VECTOR[__lane]; \
+  }
+
+static inline void _load4(const void * base, size_t stride, __m128 fields[4]) {
+  __m128 a = _mm_loadu_ps((const float *)STATS_AT(base, stride, 0));
+  __m128 b = _mm_loadu_ps((const float *)STATS_AT(base, stride, 1));
+  __m128 c = _mm_loadu_ps((const float *)STATS_AT(base, stride, 2));
+  __m128 d = _mm_loadu_ps((const float *)STATS_AT(base, stride, 3));
+  _MM_TRANSPOSE4_PS(a, b, c, d);
+  fields[0] = a;
+  fields[1] = b;
+  fields[2] = c;
+  fields[3] = d;
+}
+
+static inline void _store4(void * base, size_t stride, const __m128 fields[4]) {
+  __m128 a = fields[0], b = fields[1], c = fields[2], d = fields[3];
+  _MM_TRANSPOSE4_PS(a, b, c, d);
+  _mm_storeu_ps((float *)STATS_AT(base, stride, 0), a);
+  _mm_storeu_ps((float *)STATS_AT(base, stride, 1), b);
+  _mm_storeu_ps((float *)STATS_AT(base, stride, 2), c);
+  _mm_storeu_ps((float *)STATS_AT(base, stride, 3), d);
+}
+
+// the first four fields of every lane, one vector per field
+static inline void _load_fields(const void * base, size_t stride, StatsVector fields[4]) {
+#if defined(__AVX__)
+  __m128 lo[4], hi[4];
+  _load4(base, stride, lo);
+  _load4(STATS_AT(base, stride, 4), stride, hi);
+  for(uint32_t i = 0; i < 4; i++) {
+    fields[i] = (StatsVector)_mm256_set_m128(hi[i], lo[i]);
+  }
+#else
+  _load4(base, stride, (__m128 *)fields);
+#endif
+}
+
+static inline void _store_fields(void * base, size_t stride, const StatsVector fields[4]) {
+#if defined(__AVX__)
+  __m128 lo[4], hi[4];
+  for(uint32_t i = 0; i < 4; i++) {
+    lo[i] = _mm256_castps256_ps128((__m256)fields[i]);
+    hi[i] = _mm256_extractf128_ps((__m256)fields[i], 1);
+  }
+  _store4(base, stride, lo);
+  _store4(STATS_AT(base, stride, 4), stride, hi);
+#else
+  _store4(base, stride, (const __m128 *)fields);
+#endif
+}
+
+void LiveValue_update_batch(uint32_t count, LiveValue * live, size_t stride, const alias_R * delta, const alias_R * max, alias_R frame_time, alias_R time) {
+  const StatsVector zero = { 0 };
+  const StatsVector now = zero + time;
+
+  uint32_t i = 0;
+  for(; i + STATS_LANES <= count; i += STATS_LANES) {
+    LiveValue * base = (LiveValue *)STATS_AT(live, stride, i);
+
+    // current, damage, depleted_time, last_damage_time
+    StatsVector fields[4];
+    _load_fields(base, stride, fields);
+    StatsVector full_time = STATS_GATHER(base, stride, LiveValue, full_time);
+    StatsVector current = fields[0], damage = fields[1], d, m;
+    memcpy(&d, delta + i, sizeof(d));
+    memcpy(&m, max + i, sizeof(m));
+
+    StatsMask damaged = damage > zero;
+    d = d * frame_time - _select(damaged, damage, zero);
+
+    StatsMask was_depleted = current <= zero;
+    StatsMask was_full = current >= m;
+    current += d;
+    StatsMask is_depleted = current <= zero;
+    StatsMask is_full = current >= m;
+
+    // same order as the scalar version, full wins over depleted when max is not positive
+    current = _select(is_depleted, zero, current);
+    current = _select(is_full, m, current);
+
+    fields[0] = current;
+    fields[1] = zero;
+    fields[2] = _select(is_depleted & ~was_depleted, now, fields[2]);
+    fields[3] = _select(damaged, now, fields[3]);
+    _store_fields(base, stride, fields);
+
+    full_time = _select(is_full & ~was_full, now, full_time);
+    STATS_SCATTER(full_time, base, stride, LiveValue, full_time)
+  }
+
+  for(; i < count; i++) {
+    LiveValue_update_at((LiveValue *)STATS_AT(live, stride, i), delta[i], max[i], frame_time, time);
+  }
+}
+
+void GameValue_get_batch(uint32_t count, const GameValue * gv, size_t stride, alias_R * out) {
+  uint32_t i = 0;
+  for(; i + STATS_LANES <= count; i += STATS_LANES) {
+    StatsVector current = STATS_GATHER(STATS_AT(gv, stride, i), stride, GameValue, current);
+    memcpy(out + i, &current, sizeof(current));
+  }
+
+  for(; i < count; i++) {
+    out[i] = GameValue_get((const GameValue *)STATS_AT(gv, stride, i));
+  }
+}
+
+#else
+
+void LiveValue_update_batch(uint32_t count, LiveValue * live, size_t stride, const alias_R * delta, const alias_R * max, alias_R frame_time, alias_R time) {
+  for(uint32_t i = 0; i < count; i++) {
+    LiveValue_update_at((LiveValue *)((uint8_t *)live + stride * i), delta[i], max[i], frame_time, time);
+  }
+}
+
+void GameValue_get_batch(uint32_t count, const GameValue * gv, size_t stride, alias_R * out) {
+  for(uint32_t i = 0; i < count; i++) {
+    out[i] = GameValue_get((const GameValue *)((const uint8_t *)gv + stride * i));
+  }
+}
+
+#endif
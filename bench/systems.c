@@ -0,0 +1,181 @@
+#include "../src/system.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+void CmdStream_execute_loop(alias_ecs_Instance * instance);
+
+// runs every gameplay system and the transform and physics steps over 1k, 10k, 100k and 1M actors built like
+// prefab/player.c without the player controls. each system runs on its own, timed per run. prints one line per system
+// and entity count:
+//   <system> <entities> <iterations> <ns per entity min> <ns per entity median> <entities per second> <bytes per entity> <GB/s>
+// bytes per entity is what the system reads and writes of its components, against the time it shows how close a
+// system is to memory bound. lines starting with # are comments.
+//
+//   a_cave_bench [max entities] [entity updates per measurement]
+#define BENCH_MIN_ENTITIES 1000
+#define BENCH_MAX_ENTITIES 1000000
+#define BENCH_WORK         20000000
+#define BENCH_MIN_RUNS     5
+#define BENCH_MAX_RUNS     1000
+
+static void _physics(void) {
+  alias_physics_update2d_serial_pre_transform(Engine_ecs(), Engine_physics_2d_bundle(), 1.0f / 60.0f);
+  alias_physics_update2d_serial_post_transform(Engine_ecs(), Engine_physics_2d_bundle(), 1.0f / 60.0f);
+}
+
+static void _transform(void) {
+  alias_transform_update2d_serial(Engine_ecs(), Engine_transform_bundle());
+}
+
+static const struct {
+  const char * name;
+  void (*run)(void);
+  size_t bytes;
+} _systems[] = {
+    { "movement_system", movement_system, sizeof(struct Movement) + sizeof(struct alias_Physics2DBodyMotion) + sizeof(struct alias_LocalToWorld2D) }
+  , { "armor_system", armor_system, sizeof(struct Armor) }
+  , { "shield_system", shield_system, sizeof(struct Shield) }
+  , { "power_system", power_system, sizeof(struct Power) }
+  , { "physics", _physics, sizeof(struct alias_Physics2DMotion) + sizeof(struct alias_Physics2DBodyMotion) + sizeof(struct alias_Physics2DDampen) + sizeof(struct alias_Transform2D) }
+  , { "transform", _transform, sizeof(struct alias_Transform2D) + sizeof(struct alias_LocalToWorld2D) }
+};
+
+#define BENCH_NUM_SYSTEMS (sizeof(_systems) / sizeof(_systems[0]))
+
+static uint32_t _max_entities = BENCH_MAX_ENTITIES;
+static uint64_t _work = BENCH_WORK;
+
+// half of the actors chase an entity, half push in a direction so movement keeps working every run
+static void _spawn_actors(alias_ecs_LayerHandle layer, uint32_t count) {
+  Entity target = SPAWN_LAYER(layer, ( alias_Translation2D ), ( PreviousLocalToWorld2D ));
+
+  alias_MemoryCB * mcb = alias_default_MemoryCB();
+  struct alias_Transform2D * transforms = alias_malloc(mcb, sizeof(*transforms) * count, alignof(*transforms));
+  Entity * entities = alias_malloc(mcb, sizeof(*entities) * count, alignof(*entities));
+
+  srand(1);
+  for(uint32_t i = 0; i < count; i++) {
+    alias_R x = (alias_R)(rand() % 2000) - 1000;
+    alias_R y = (alias_R)(rand() % 2000) - 1000;
+    transforms[i] = (struct alias_Transform2D) { .value = alias_pga2d_translator_to(alias_pga2d_point(x, y)) };
+  }
+
+  #define BENCH_ACTOR(COUNT, TRANSFORMS, ENTITIES, ...) \
+    SPAWN_LAYER_N( layer, COUNT, ENTITIES \
+                 , each( alias_Transform2D, TRANSFORMS ) \
+                 , shared( Movement, __VA_ARGS__, .movement_speed = 10 ) \
+                 , shared( alias_Physics2DDampen, .value = 5 ) \
+                 , shared( PreviousLocalToWorld2D ) \
+                 , shared( Armor \
+                         , .live = LIVE_VALUE(100) \
+                         , .max = GAME_VALUE(100) \
+                         , .regen_per_second = GAME_VALUE(1) \
+                         , .regen_percent_per_second = GAME_VALUE(0) \
+                         ) \
+                 , shared( Shield \
+                         , .live = LIVE_VALUE(50) \
+                         , .max = GAME_VALUE(100) \
+                         , .regen_per_second = GAME_VALUE(0) \
+                         , .regen_percent_per_second = GAME_VALUE(0) \
+                         , .recharge_delay = GAME_VALUE(3) \
+                         , .recharge_per_second = GAME_VALUE(0) \
+                         , .recharge_percentage_per_second = GAME_VALUE(20) \
+                         , .recharge_power_per_second = GAME_VALUE(50) \
+                         ) \
+                 , shared( Power \
+                         , .live = LIVE_VALUE(0) \
+                         , .max  = GAME_VALUE(100) \
+                         , .generation_per_second = GAME_VALUE(40) \
+                         ) \
+                 , shared( DrawRectangle, .width = 20, .height = 10, .color = alias_Color_from_rgb_u8(100, 100, 255) ) \
+                 , shared( DrawCircle, .radius = 6, .color = alias_Color_from_rgb_u8(100, 100, 255) ) \
+                 )
+
+  uint32_t half = count / 2;
+  BENCH_ACTOR(half, transforms, entities, .target = MovementTarget_Entity, .target_entity = target);
+  BENCH_ACTOR(count - half, transforms + half, entities + half, .target = MovementTarget_WorldDirection, .target_direction = alias_pga2d_direction(1, 0));
+
+  #undef BENCH_ACTOR
+
+  alias_free(mcb, transforms, sizeof(*transforms) * count, alignof(*transforms));
+  alias_free(mcb, entities, sizeof(*entities) * count, alignof(*entities));
+}
+
+static int _compare_u64(const void * ap, const void * bp) {
+  uint64_t a = *(const uint64_t *)ap;
+  uint64_t b = *(const uint64_t *)bp;
+  return (a > b) - (a < b);
+}
+
+static void _measure(uint32_t count) {
+  alias_ecs_LayerHandle layer = Engine_create_layer(0);
+
+  uint64_t start = uv_hrtime();
+  _spawn_actors(layer, count);
+  printf("# spawn %u %.3f ns per entity\n", count, (double)(uv_hrtime() - start) / count);
+
+  uint32_t runs = alias_max(BENCH_MIN_RUNS, alias_min(BENCH_MAX_RUNS, _work / count));
+  uint64_t * times = alias_malloc(alias_default_MemoryCB(), sizeof(*times) * runs, alignof(*times));
+
+  for(uint32_t s = 0; s < BENCH_NUM_SYSTEMS; s++) {
+    // one run to settle caches and lazily built queries
+    _systems[s].run();
+    CmdStream_execute_loop(Engine_ecs());
+
+    // every run is inside the one bench frame, the commands it recorded go in untimed before the next like they would
+    // at a sync point, so the loop stream does not grow by a fork per run
+    for(uint32_t r = 0; r < runs; r++) {
+      uint64_t t = uv_hrtime();
+      _systems[s].run();
+      times[r] = uv_hrtime() - t;
+      CmdStream_execute_loop(Engine_ecs());
+    }
+    qsort(times, runs, sizeof(*times), _compare_u64);
+
+    double min = (double)times[0] / count;
+    double median = (double)times[runs / 2] / count;
+    printf("%s %u %u %.3f %.3f %.0f %zu %.3f\n"
+      , _systems[s].name
+      , count
+      , runs
+      , min
+      , median
+      , 1e9 / median
+      , _systems[s].bytes
+      , (double)_systems[s].bytes / median
+      );
+    fflush(stdout);
+  }
+
+  alias_free(alias_default_MemoryCB(), times, sizeof(*times) * runs, alignof(*times));
+
+  Engine_destroy_layer(layer);
+}
+
+static void _bench_frame(void * ud) {
+  (void)ud;
+
+  printf("# system entities iterations min_ns_per_entity median_ns_per_entity entities_per_second bytes_per_entity gb_per_second\n");
+  for(uint32_t count = BENCH_MIN_ENTITIES; count <= _max_entities; count *= 10) {
+    _measure(count);
+  }
+
+  Engine_pop_state();
+}
+
+static struct State _bench_state = {
+  .frame = _bench_frame
+};
+
+int main(int argc, char * argv[]) {
+  if(argc > 1) {
+    _max_entities = strtoul(argv[1], NULL, 10);
+  }
+  if(argc > 2) {
+    _work = strtoull(argv[2], NULL, 10);
+  }
+
+  Engine_init(640, 480, "a_cave_bench", &_bench_state);
+  Engine_run();
+}
@@ -4,7 +4,7 @@
 static void _player_control_movement_init(void * ud, alias_ecs_Instance * instance, alias_ecs_EntityHandle entity, void ** data) {
   struct PlayerControlMovement * player_control = (struct PlayerControlMovement *)data[0];
 
-  struct PlayerInputs * inputs = alias_malloc(alias_default_MemoryCB(), sizeof(*inputs), alignof(*inputs));
+  struct PlayerInputs * inputs = Engine_layer_alloc(player_control->layer, sizeof(*inputs), alignof(*inputs));
   player_control->inputs = inputs;
 
   inputs->pause = INPUT_SIGNAL_UP(Binding_Pause);
@@ -22,11 +22,22 @@ static void _player_control_movement_init(void * ud, alias_ecs_Instance * instan
 }
 
 static void _player_control_movement_cleanup(void * ud, alias_ecs_Instance * instance, alias_ecs_EntityHandle entity, void ** data) {
-  struct PlayerControlMovement * player_control = *(struct PlayerControlMovement **)data[0];
+  struct PlayerControlMovement * player_control = (struct PlayerControlMovement *)data[0];
 
+  // the inputs go with the layer
   Engine_remove_input_frontend(player_control->player_index, player_control->input_index);
+}
+
+static void _player_control_movement_entities(void * data, Entity (*map)(void * ud, Entity entity), void * ud) {
+  struct PlayerControlMovement * player_control = (struct PlayerControlMovement *)data;
+  player_control->target = map(ud, player_control->target);
+}
 
-  alias_free(alias_default_MemoryCB(), player_control->inputs, sizeof(player_control->inputs), alignof(player_control->inputs));
+// init makes new inputs for a loaded one, in the layer it is loaded into
+static void _player_control_movement_pointers(void * data, intptr_t slide) {
+  struct PlayerControlMovement * player_control = (struct PlayerControlMovement *)data;
+  player_control->layer = Snapshot_layer();
+  player_control->inputs = NULL;
 }
 
 COMPONENT(
@@ -36,12 +47,27 @@ COMPONENT(
   , .init = { _player_control_movement_init, NULL }
   , .cleanup = { _player_control_movement_cleanup, NULL }
   )
+COMPONENT_SNAPSHOT(PlayerControlMovement, _player_control_movement_entities, _player_control_movement_pointers)
+
+static void _movement_entities(void * data, Entity (*map)(void * ud, Entity entity), void * ud) {
+  struct Movement * movement = (struct Movement *)data;
+  if(movement->target == MovementTarget_Entity) {
+    movement->target_entity = map(ud, movement->target_entity);
+  }
+}
+
+// the cache points into the ecs that saved it
+static void _movement_pointers(void * data, intptr_t slide) {
+  struct Movement * movement = (struct Movement *)data;
+  movement->target_cache = (struct ComponentCache) { 0 };
+}
 
 DEFINE_COMPONENT(
     Movement
   , .num_required_components = 1
   , .required_components = (alias_ecs_ComponentHandle[]) { alias_Physics2DBodyMotion_component() }
   )
+COMPONENT_SNAPSHOT(Movement, _movement_entities, _movement_pointers)
 
 DEFINE_COMPONENT(Shield)
 
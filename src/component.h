@@ -15,6 +15,7 @@ DECLARE_COMPONENT(Movement, {
     alias_pga2d_Point      target_point;
     alias_pga2d_Point      target_direction;
   };
+  struct ComponentCache target_cache;
 
   alias_R movement_speed;
   bool done;
@@ -31,10 +32,11 @@ typedef struct LiveValue {
 
 #define LIVE_VALUE(X) (LiveValue) { .current = X, .damage = alias_R_ZERO }
 
-static inline void LiveValue_update(LiveValue * live, alias_R delta, alias_R max) {
-  delta *= Engine_frame_time();
+// frame_time and time are passed in so batches can hoist them
+static inline void LiveValue_update_at(LiveValue * live, alias_R delta, alias_R max, alias_R frame_time, alias_R time) {
+  delta *= frame_time;
   if(live->damage > alias_R_ZERO) {
-    live->last_damage_time = Engine_time();
+    live->last_damage_time = time;
     delta -= live->damage;
   }
   live->damage = alias_R_ZERO;
@@ -46,17 +48,21 @@ static inline void LiveValue_update(LiveValue * live, alias_R delta, alias_R max
   if(is_depleted) {
     live->current = alias_R_ZERO;
     if(!was_depleted) {
-      live->depleted_time = Engine_time();
+      live->depleted_time = time;
     }
   }
   if(is_full) {
     live->current = max;
     if(!was_full) {
-      live->full_time = Engine_time();
+      live->full_time = time;
     }
   }
 }
 
+static inline void LiveValue_update(LiveValue * live, alias_R delta, alias_R max) {
+  LiveValue_update_at(live, delta, max, Engine_frame_time(), Engine_time());
+}
+
 typedef struct GameValue {
   alias_R current;
   alias_R base;
@@ -65,55 +71,59 @@ typedef struct GameValue {
   alias_R more;
 } GameValue;
 
-#define GAME_VALUE(X) (GameValue) { .current = alias_R_NAN, .base = X, .added = alias_R_ZERO, .increased = alias_R_ONE, .more = alias_R_ONE }
+#define GAME_VALUE(X) (GameValue) { .current = X, .base = X, .added = alias_R_ZERO, .increased = alias_R_ONE, .more = alias_R_ONE }
+
+// current is refreshed by every modifier so GameValue_get is a plain read, systems that only read(...) a component
+// never write to it
+static inline void _GameValue_refresh(GameValue * gv) {
+  gv->current = (gv->base + gv->added) * gv->increased * gv->more;
+}
 
 static inline void GameValue_init(GameValue * gv, alias_R base) {
   gv->base = base;
   gv->added = alias_R_ZERO;
   gv->increased = alias_R_ONE;
   gv->more = alias_R_ONE;
+  _GameValue_refresh(gv);
 }
 
 // amount must be greater than 0
 static inline void GameValue_added(GameValue * gv, alias_R amount) {
-  gv->current = alias_R_NAN;
   gv->added += amount;
+  _GameValue_refresh(gv);
 }
 
 // amount must be greater than 0
 static inline void GameValue_subtracted(GameValue * gv, alias_R amount) {
-  gv->current = alias_R_NAN;
   gv->added -= amount;
+  _GameValue_refresh(gv);
 }
 
 // amount must be greater than 0, 1 is the same as 100% increased
 static inline void GameValue_increase(GameValue * gv, alias_R amount) {
-  gv->current = alias_R_NAN;
   gv->increased += amount;
+  _GameValue_refresh(gv);
 }
 
 // amount must be greater than 0, 1 is the same as 100% decreased
 static inline void GameValue_decrease(GameValue * gv, alias_R amount) {
-  gv->current = alias_R_NAN;
   gv->increased -= amount;
+  _GameValue_refresh(gv);
 }
 
 // amount must be greater than 0, 1 is the same as 100% more
 static inline void GameValue_more(GameValue * gv, alias_R amount) {
-  gv->current = alias_R_NAN;
   gv->more *= alias_R_ONE + amount;
+  _GameValue_refresh(gv);
 }
 
 // amount must be greater than 0, 1 is the same as 100% less
 static inline void GameValue_less(GameValue * gv, alias_R amount) {
-  gv->current = alias_R_NAN;
   gv->more /= alias_R_ONE + amount;
+  _GameValue_refresh(gv);
 }
 
 static inline alias_R GameValue_get(const GameValue * gv) {
-  if(alias_R_isnan(gv->current)) {
-    *(alias_R *)&gv->current = (gv->base + gv->added) * gv->increased * gv->more;
-  }
   return gv->current;
 }
 
@@ -160,6 +170,7 @@ struct PlayerInputs {
 };
 
 DECLARE_COMPONENT(PlayerControlMovement, {
+  alias_ecs_LayerHandle layer; // inputs live in its memory
   uint32_t player_index;
   uint32_t input_index;
   Entity target;
@@ -0,0 +1,153 @@
+#include "engine.h"
+
+#include <alias/data_structure/vector.h>
+#include <alias/log.h>
+
+// ====================================================================================================================
+// Arena ==============================================================================================================
+struct ArenaBlock {
+  struct ArenaBlock * next;
+  size_t capacity;
+  size_t used;
+  _Alignas(16) uint8_t data[];
+};
+
+static struct ArenaBlock * _arena_block(size_t capacity) {
+  struct ArenaBlock * block = alias_malloc(alias_default_MemoryCB(), sizeof(*block) + capacity, alignof(*block));
+  block->next = NULL;
+  block->capacity = capacity;
+  block->used = 0;
+  return block;
+}
+
+static inline size_t _arena_align(const struct ArenaBlock * block, size_t align) {
+  uintptr_t at = (uintptr_t)(block->data + block->used);
+  return block->used + (((at + align - 1) & ~(uintptr_t)(align - 1)) - at);
+}
+
+void * Arena_alloc(struct Arena * arena, size_t size, size_t align) {
+  size_t block_size = arena->block_size ? arena->block_size : ARENA_DEFAULT_BLOCK_SIZE;
+
+  // blocks after current are left over from before a reset
+  struct ArenaBlock * block = arena->current;
+  while(block != NULL && _arena_align(block, align) + size > block->capacity) {
+    block = block->next;
+    if(block != NULL) {
+      block->used = 0;
+    }
+  }
+
+  if(block == NULL) {
+    block = _arena_block(alias_max(block_size, size + align));
+    if(arena->current != NULL) {
+      // keep the unused rest of the chain after the new block
+      block->next = arena->current->next;
+      arena->current->next = block;
+    } else {
+      block->next = arena->blocks;
+      arena->blocks = block;
+    }
+  }
+
+  arena->current = block;
+  size_t offset = _arena_align(block, align);
+  block->used = offset + size;
+  return block->data + offset;
+}
+
+void Arena_reset(struct Arena * arena) {
+  arena->current = arena->blocks;
+  if(arena->current != NULL) {
+    arena->current->used = 0;
+  }
+}
+
+void Arena_free(struct Arena * arena) {
+  struct ArenaBlock * block = arena->blocks;
+  while(block != NULL) {
+    struct ArenaBlock * next = block->next;
+    alias_free(alias_default_MemoryCB(), block, sizeof(*block) + block->capacity, alignof(*block));
+    block = next;
+  }
+  arena->blocks = NULL;
+  arena->current = NULL;
+}
+
+// ====================================================================================================================
+// Layer ==============================================================================================================
+// there are only ever a handful of layers, a linear search is fine
+struct LayerArena {
+  alias_ecs_LayerHandle layer;
+  struct Arena arena;
+};
+
+static alias_Vector(struct LayerArena) _layer_arenas = ALIAS_VECTOR_INIT;
+static struct Arena _engine_arena;
+
+static struct Arena * _layer_arena(alias_ecs_LayerHandle layer) {
+  if(layer == ALIAS_ECS_INVALID_LAYER) {
+    return &_engine_arena;
+  }
+  for(uint32_t i = 0; i < _layer_arenas.length; i++) {
+    if(_layer_arenas.data[i].layer == layer) {
+      return &_layer_arenas.data[i].arena;
+    }
+  }
+  return NULL;
+}
+
+alias_ecs_LayerHandle Engine_create_layer(uint32_t max_entities) {
+  alias_ecs_LayerHandle layer = ALIAS_ECS_INVALID_LAYER;
+  if(alias_ecs_create_layer(Engine_ecs(), &(alias_ecs_LayerCreateInfo) { .max_entities = max_entities }, &layer) != ALIAS_ECS_SUCCESS) {
+    ALIAS_ERROR("could not create layer");
+    return ALIAS_ECS_INVALID_LAYER;
+  }
+
+  alias_Vector_space_for(&_layer_arenas, alias_default_MemoryCB(), 1);
+  *alias_Vector_push(&_layer_arenas) = (struct LayerArena) { .layer = layer };
+  return layer;
+}
+
+void Engine_destroy_layer(alias_ecs_LayerHandle layer) {
+  // cleanup callbacks may still read their layer memory
+  alias_ecs_destroy_layer(Engine_ecs(), layer, ALIAS_ECS_LAYER_DESTROY_REMOVE_ENTITIES);
+  Engine_ecs_changed();
+
+  for(uint32_t i = 0; i < _layer_arenas.length; i++) {
+    if(_layer_arenas.data[i].layer == layer) {
+      Arena_free(&_layer_arenas.data[i].arena);
+      _layer_arenas.data[i] = *alias_Vector_pop(&_layer_arenas);
+      break;
+    }
+  }
+}
+
+void * Engine_layer_alloc(alias_ecs_LayerHandle layer, size_t size, size_t align) {
+  struct Arena * arena = _layer_arena(layer);
+  if(arena == NULL) {
+    ALIAS_ERROR("layer %u was not created with Engine_create_layer", layer);
+    arena = &_engine_arena;
+  }
+  return Arena_alloc(arena, size, align);
+}
+
+// ====================================================================================================================
+// Frame ==============================================================================================================
+// two arenas take turns, each is reset when its turn comes around again so memory from the previous frame is still
+// valid during the current one
+static struct Arena _frame_arenas[2];
+static uint32_t _frame_arena;
+
+void FrameArena_begin(void) {
+  _frame_arena ^= 1;
+  Arena_reset(&_frame_arenas[_frame_arena]);
+}
+
+void FrameArena_cleanup(void) {
+  Arena_free(&_frame_arenas[0]);
+  Arena_free(&_frame_arenas[1]);
+}
+
+void * Engine_frame_alloc(size_t size, size_t align) {
+  return Arena_alloc(&_frame_arenas[_frame_arena], size, align);
+}
@@ -3,14 +3,19 @@
 #include "engine.h"
 
 void Backend_init_window(uint32_t width, uint32_t height, const char * title);
+void Backend_cleanup(void);
 void Backend_set_target_fps(uint32_t fps);
+uint32_t Backend_get_target_fps(void);
 bool Backend_should_exit(void);
+void Backend_poll_events(void);
 
 bool Backend_get_key_down(enum InputSource source);
 bool Backend_get_mouse_button_down(enum InputSource source);
 float Backend_get_mouse_position_x(void);
 float Backend_get_mouse_position_y(void);
 float Backend_get_time(void);
+
+// a fixed frame time in seconds for backends with their own clock, 0 when frames are measured
 float Backend_get_frame_time(void);
 
 enum BackendSampler {
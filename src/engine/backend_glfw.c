@@ -17,12 +17,19 @@ static struct {
 
   uint32_t width;
   uint32_t height;
+
+  uint32_t target_fps;
+  bool target_fps_set;
 } _;
 
 bool Vulkan_init(uint32_t * width, uint32_t * height, GLFWwindow * window);
 void Vulkan_cleanup(void);
 
 void Backend_init_window(uint32_t width, uint32_t height, const char * title) {
+  if(!_.target_fps_set) {
+    _.target_fps = 60;
+  }
+
   if(!glfwInit()) {
     return;
   }
@@ -42,20 +49,33 @@ void Backend_init_window(uint32_t width, uint32_t height, const char * title) {
   }
 }
 
+// the surface and swapchain hang off the window, vulkan goes first
 void Backend_cleanup(void) {
+  Vulkan_cleanup();
+
   glfwDestroyWindow(_.window);
   glfwTerminate();
-
-  Vulkan_cleanup();
 }
 
+// the swapchain is not vsync limited, frames are paced by the engine against this target
 void Backend_set_target_fps(uint32_t fps) {
+  _.target_fps = fps;
+  _.target_fps_set = true;
+}
+
+uint32_t Backend_get_target_fps(void) {
+  return _.target_fps;
 }
 
 bool Backend_should_exit(void) {
   return _.window == NULL || glfwWindowShouldClose(_.window);
 }
 
+// glfw requires events to be pumped from the main thread, never from the render thread
+void Backend_poll_events(void) {
+  glfwPollEvents();
+}
+
 bool Backend_get_key_down(enum InputSource source) {
 }
 
@@ -72,6 +92,8 @@ float Backend_get_time(void) {
   return glfwGetTime();
 }
 
+// frames are real time here, the engine measures them with uv_hrtime on the same clock it paces them with
 float Backend_get_frame_time(void) {
+  return 0;
 }
 
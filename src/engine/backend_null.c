@@ -0,0 +1,215 @@
+#include "engine.h"
+
+#include "backend.h"
+
+#include <alias/log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "stb_image.h"
+
+// a backend without a window or a gpu, for benchmarks and soak tests. everything is driven by the environment:
+//   ENGINE_NULL_FRAME_TIME  seconds per frame on the simulated clock, default 1/60
+//   ENGINE_NULL_FRAMES      exit after this many frames, default 0 runs until the game exits
+//   ENGINE_NULL_FPS         pace frames like a real backend would, default 0 runs frames back to back
+//   ENGINE_NULL_INPUT       input script, one event per line: <frame> <InputSource> <value>
+// a key or button is down while its value is not zero, mouse positions take the value as is. events hold until a later
+// event for the same source. lines can come in any order, they are sorted by frame and keep file order within a frame.
+// lines starting with # are ignored.
+// rendering only counts what it is given.
+#define NULL_SCRIPT_MAX_EVENTS 65536
+
+struct NullInputEvent {
+  uint64_t frame;
+  uint32_t line;
+  enum InputSource source;
+  float value;
+};
+
+static struct {
+  uint32_t width;
+  uint32_t height;
+
+  uint32_t target_fps;
+  double frame_time;
+  uint64_t max_frames;
+  uint64_t frame;
+
+  float input[InputSource_COUNT];
+  uint32_t num_script_events;
+  uint32_t script_cursor;
+  struct NullInputEvent * script;
+
+  uint64_t num_draws;
+  uint64_t num_vertexes;
+  uint64_t num_indexes;
+} _;
+
+static int _script_compare(const void * ap, const void * bp) {
+  const struct NullInputEvent * a = (const struct NullInputEvent *)ap, * b = (const struct NullInputEvent *)bp;
+  if(a->frame != b->frame) {
+    return a->frame < b->frame ? -1 : 1;
+  }
+  return (a->line > b->line) - (a->line < b->line);
+}
+
+static void _load_script(const char * path) {
+  FILE * file = fopen(path, "r");
+  if(file == NULL) {
+    ALIAS_ERROR("could not open input script %s", path);
+    return;
+  }
+
+  _.script = alias_malloc(alias_default_MemoryCB(), sizeof(*_.script) * NULL_SCRIPT_MAX_EVENTS, alignof(*_.script));
+
+  char line[256];
+  while(fgets(line, sizeof(line), file) != NULL && _.num_script_events < NULL_SCRIPT_MAX_EVENTS) {
+    unsigned long long frame;
+    unsigned int source;
+    float value;
+    if(line[0] == '#' || sscanf(line, "%llu %u %f", &frame, &source, &value) != 3) {
+      continue;
+    }
+    if(source >= InputSource_COUNT) {
+      ALIAS_ERROR("input script %s: unknown input source %u", path, source);
+      continue;
+    }
+    _.script[_.num_script_events] = (struct NullInputEvent) { .frame = frame, .line = _.num_script_events, .source = source, .value = value };
+    _.num_script_events++;
+  }
+
+  fclose(file);
+
+  qsort(_.script, _.num_script_events, sizeof(*_.script), _script_compare);
+}
+
+void Backend_init_window(uint32_t width, uint32_t height, const char * title) {
+  (void)title;
+
+  const char * frame_time = getenv("ENGINE_NULL_FRAME_TIME");
+  const char * frames = getenv("ENGINE_NULL_FRAMES");
+  const char * fps = getenv("ENGINE_NULL_FPS");
+  const char * script = getenv("ENGINE_NULL_INPUT");
+
+  _.width = width;
+  _.height = height;
+  _.frame_time = frame_time ? atof(frame_time) : 1.0 / 60.0;
+  _.max_frames = frames ? strtoull(frames, NULL, 10) : 0;
+  if(fps != NULL) {
+    _.target_fps = strtoul(fps, NULL, 10);
+  }
+
+  if(script != NULL) {
+    _load_script(script);
+  }
+}
+
+void Backend_cleanup(void) {
+  ALIAS_INFO("null backend: %llu frames, %llu draws, %llu vertexes, %llu indexes"
+    , (unsigned long long)_.frame
+    , (unsigned long long)_.num_draws
+    , (unsigned long long)_.num_vertexes
+    , (unsigned long long)_.num_indexes
+    );
+}
+
+void Backend_set_target_fps(uint32_t fps) {
+  _.target_fps = fps;
+}
+
+uint32_t Backend_get_target_fps(void) {
+  return _.target_fps;
+}
+
+bool Backend_should_exit(void) {
+  return _.max_frames > 0 && _.frame >= _.max_frames;
+}
+
+// one poll per frame, this is what advances the clock and the script
+void Backend_poll_events(void) {
+  _.frame++;
+
+  while(_.script_cursor < _.num_script_events && _.script[_.script_cursor].frame <= _.frame) {
+    const struct NullInputEvent * event = &_.script[_.script_cursor++];
+    _.input[event->source] = event->value;
+  }
+}
+
+bool Backend_get_key_down(enum InputSource source) {
+  return _.input[source] != 0;
+}
+
+bool Backend_get_mouse_button_down(enum InputSource source) {
+  return _.input[source] != 0;
+}
+
+float Backend_get_mouse_position_x(void) {
+  return _.input[Mouse_Position_X];
+}
+
+float Backend_get_mouse_position_y(void) {
+  return _.input[Mouse_Position_Y];
+}
+
+float Backend_get_time(void) {
+  return _.frame * _.frame_time;
+}
+
+float Backend_get_frame_time(void) {
+  return _.frame_time;
+}
+
+// only the size is loaded, nothing ever samples the image
+void BackendImage_load(struct BackendImage * image, const char * filename) {
+  int width = 1, height = 1, components;
+
+  FILE * file = fopen(filename, "rb");
+  if(file != NULL) {
+    stbi_uc header[1024];
+    size_t length = fread(header, 1, sizeof(header), file);
+    if(!stbi_info_from_memory(header, length, &width, &height, &components)) {
+      width = height = 1;
+    }
+    fclose(file);
+  }
+
+  image->width = width;
+  image->height = height;
+  image->depth = 1;
+  image->levels = 1;
+  image->layers = 1;
+}
+
+void BackendImage_unload(struct BackendImage * image) {
+  (void)image;
+}
+
+void BackendUIVertex_render(const struct BackendImage * image, struct BackendUIVertex * vertexes, uint32_t num_indexes, const uint32_t * indexes) {
+  (void)image;
+
+  uint32_t num_vertexes = 0;
+  for(uint32_t i = 0; i < num_indexes; i++) {
+    num_vertexes = alias_max(num_vertexes, indexes[i] + 1);
+  }
+  (void)vertexes;
+
+  _.num_draws++;
+  _.num_vertexes += num_vertexes;
+  _.num_indexes += num_indexes;
+}
+
+void Backend_begin_rendering(uint32_t screen_width, uint32_t screen_height) {
+  (void)screen_width;
+  (void)screen_height;
+}
+
+void Backend_end_rendering(void) {
+}
+
+void Backend_begin_2d(struct BackendMode2D mode) {
+  (void)mode;
+}
+
+void Backend_end_2d(void) {
+}
@@ -28,14 +28,27 @@ void Backend_init_window(uint32_t width, uint32_t height, const char * title) {
   SetExitKey('Q');
 }
 
+void Backend_cleanup(void) {
+  CloseWindow();
+}
+
 void Backend_set_target_fps(uint32_t fps) {
   SetTargetFPS(fps);
 }
 
+uint32_t Backend_get_target_fps(void) {
+  // raylib paces itself in EndDrawing
+  return 0;
+}
+
 bool Backend_should_exit(void) {
   return WindowShouldClose();
 }
 
+void Backend_poll_events(void) {
+  // raylib polls in EndDrawing
+}
+
 static const int _input_source_to_raylib[] = {
   [Keyboard_Apostrophe] =   KEY_APOSTROPHE,
   [Keyboard_Comma] =        KEY_COMMA,
@@ -166,8 +179,9 @@ float Backend_get_time(void) {
   return GetTime();
 }
 
+// frames are measured by the engine
 float Backend_get_frame_time(void) {
-  return GetFrameTime();
+  return 0;
 }
 
 void BackendImage_load(struct BackendImage * image, const char * filename) {
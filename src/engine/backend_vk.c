@@ -173,6 +173,10 @@ static struct {
 
   bool validation;
 
+  // image uploads complete on the loop thread while a frame may be recorded on the render thread. guards the command
+  // buffer lists, the pending transitions and the queues, a frame is recorded outside of it
+  uv_mutex_t submit_lock;
+
   VkInstance instance;
 
   bool debug_utils;
@@ -221,6 +225,7 @@ static struct {
 
   alias_Vector(struct CommandBuffer) command_buffers[NUM_QUEUES];
   uint32_t rendering_cbuf;
+  VkCommandBuffer rendering_buffer; // the list can grow under the lock while a frame is recorded outside it
 
   alias_Vector(struct AllocationBlock) allocation_blocks;
 
@@ -2368,6 +2373,7 @@ bool Vulkan_init(uint32_t * width, uint32_t * height, GLFWwindow * window) {
   alias_memory_clear(&_, sizeof(_));
   _.window = window;
   _.validation = 1;
+  uv_mutex_init(&_.submit_lock);
   for(uint32_t i = 0; i < NUM_QUEUES; i++) {
     _.transition_cbuf[i] = -1;
   }
@@ -2451,6 +2457,7 @@ static void _image_read(uv_fs_t * req) {
   uv_fs_req_cleanup(req);
 
   if(req->result < 0) {
+    TRACE_ASYNC_END("image load", (uintptr_t)ctx);
     alias_free(alias_default_MemoryCB(), ctx->buf.base, ctx->buf.len, 4);
     alias_free(alias_default_MemoryCB(), ctx, sizeof(*ctx), alignof(*ctx));
     return;
@@ -2468,6 +2475,8 @@ static void _image_read(uv_fs_t * req) {
   uv_fs_close(Engine_uv_loop(), &ctx->req, ctx->fd, _image_close);
 
   // Vulkan loading here
+  uv_mutex_lock(&_.submit_lock);
+
   VkDeviceSize size = width * height * 4;
 
   VkDeviceSize offset;
@@ -2740,12 +2749,18 @@ static void _image_read(uv_fs_t * req) {
     width = mipped_width;
     height = mipped_height;
   }
+
+  uv_mutex_unlock(&_.submit_lock);
+
+  // ctx is only freed once the close completes, its address still names this load
+  TRACE_ASYNC_END("image load", (uintptr_t)ctx);
 }
 
 static void _image_fstat(uv_fs_t * req) {
   struct ImageLoadContext * ctx = (struct ImageLoadContext *)req->data;
 
   if(req->result < 0) {
+    TRACE_ASYNC_END("image load", (uintptr_t)ctx);
     uv_fs_req_cleanup(req);
     alias_free(alias_default_MemoryCB(), ctx, sizeof(*ctx), alignof(*ctx));
     return;
@@ -2764,6 +2779,7 @@ static void _image_open(uv_fs_t * req) {
   struct ImageLoadContext * ctx = (struct ImageLoadContext *)req->data;
 
   if(req->result < 0) {
+    TRACE_ASYNC_END("image load", (uintptr_t)ctx);
     uv_fs_req_cleanup(req);
     alias_free(alias_default_MemoryCB(), ctx, sizeof(*ctx), alignof(*ctx));
     return;
@@ -2779,13 +2795,16 @@ void BackendImage_load(struct BackendImage * image, const char * filename) {
   struct ImageLoadContext * ctx = alias_malloc(alias_default_MemoryCB(), sizeof(*ctx), alignof(*ctx));
   ctx->image = image;
   ctx->req.data = ctx;
+  TRACE_ASYNC_BEGIN("image load", (uintptr_t)ctx);
   uv_fs_open(Engine_uv_loop(), &ctx->req, filename, O_RDONLY, 0, _image_open);
 }
 
 void BackendImage_unload(struct BackendImage * image) {
+  uv_mutex_lock(&_.submit_lock);
   vkDestroyImageView((VkImageView)image->imageview);
   vkDestroyImage((VkImage)image->image);
   vkFreeMemory((VkDeviceMemory)image->memory);
+  uv_mutex_unlock(&_.submit_lock);
 }
 
 void BackendUIVertex_render(const struct BackendImage * image, struct BackendUIVertex * vertexes, uint32_t num_indexes, const uint32_t * indexes) {
@@ -2799,7 +2818,7 @@ void BackendUIVertex_render(const struct BackendImage * image, struct BackendUIV
 }
 
 static void set_default_viewport_scissor(void) {
-  VkCommandBuffer cbuf = _.command_buffers[Graphics].data[_.rendering_cbuf].buffer;
+  VkCommandBuffer cbuf = _.rendering_buffer;
 
   vkCmdSetViewport(cbuf, 1, 1, &(VkViewport) {
       .x = 0
@@ -2818,9 +2837,13 @@ static void set_default_viewport_scissor(void) {
 
 void Backend_begin_rendering(uint32_t screen_width, uint32_t screen_height) {
   vkAcquireNextImageKHR(_.swapchain, UINT64_MAX, _.frame_gpu_present_to_gpu_graphics, VK_NULL_HANDLE, &_.swapchain_current_index);
+
+  uv_mutex_lock(&_.submit_lock);
   _.rendering_cbuf = acquire_command_buffer(Graphics);
+  _.rendering_buffer = _.command_buffers[Graphics].data[_.rendering_cbuf].buffer;
+  uv_mutex_unlock(&_.submit_lock);
 
-  VkCommandBuffer cbuf = _.command_buffers[Graphics].data[_.rendering_cbuf].buffer;
+  VkCommandBuffer cbuf = _.rendering_buffer;
   
   vkCmdBeginRenderPass(
       cbuf
@@ -2841,7 +2864,9 @@ void Backend_begin_rendering(uint32_t screen_width, uint32_t screen_height) {
 }
 
 void Backend_end_rendering(void) {
-  vkCmdEndRenderPass(_.command_buffers[Graphics].data[_.rendering_cbuf].buffer);
+  vkCmdEndRenderPass(_.rendering_buffer);
+
+  uv_mutex_lock(&_.submit_lock);
 
   VkSemaphore transfer_semaphore = VK_NULL_HANDLE;
 
@@ -2921,12 +2946,12 @@ void Backend_end_rendering(void) {
     , .pImageIndices = &_.swapchain_current_index
     , .pResults = NULL
     });
-  
-  glfwPollEvents();
+
+  uv_mutex_unlock(&_.submit_lock);
 }
 
 void Backend_begin_2d(struct BackendMode2D mode) {
-  VkCommandBuffer cbuf = _.command_buffers[Graphics].data[_.rendering_cbuf].buffer;
+  VkCommandBuffer cbuf = _.rendering_buffer;
 
   VkViewport viewport = {
       .x = alias_pga2d_point_x(mode.viewport_min) * _.swapchain_extents.width
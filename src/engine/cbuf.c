@@ -1,21 +1,85 @@
-#include "util.h"
+#include "engine.h"
 
+#include <alias/log.h>
+
+#include <stdalign.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 
+bool Engine_component_is_plain(alias_ecs_ComponentHandle component);
+
+// grows an array of COUNT elements to NEW_COUNT, keeping what it holds
+#define CMD_GROW(POINTER, COUNT, NEW_COUNT)                                                                           \
+  (POINTER) = alias_realloc(alias_default_MemoryCB(), (POINTER), sizeof(*(POINTER)) * (COUNT),                        \
+                            sizeof(*(POINTER)) * (NEW_COUNT), alignof(*(POINTER)))
+
+struct CmdPage {
+  struct CmdPage * next;
+  size_t capacity;
+  size_t used;
+  _Alignas(16) uint8_t data[];
+};
+
+// pages are made on whatever thread records, the high water marks are only written on the loop thread in execute
+// buffers that spawn take the next id, ids wrap long after any placeholder of the same id is gone
+static atomic_uint_fast32_t _cmd_next_id = 1;
+
+static struct {
+  atomic_uint_fast64_t pages;
+  atomic_uint_fast64_t page_bytes;
+  uint64_t high_water_bytes;
+  uint64_t high_water_commands;
+} _stats;
+
+// every command in recording order. a command never spans pages. the walk ends at current, pages past it are left
+// from an earlier recording
+#define CMD_BUF_EACH(CBUF, CMD)                                                                                       \
+  for(const struct CmdPage * _page = (CBUF)->pages, * _end = (CBUF)->current ? (CBUF)->current->next : NULL;          \
+      _page != _end; _page = _page->next)                                                                             \
+    for(const struct Cmd * CMD = (const struct Cmd *)_page->data; (const uint8_t *)CMD < _page->data + _page->used;    \
+        CMD = (const struct Cmd *)((const uint8_t *)CMD + CMD->size))
+
+static struct CmdPage * _CmdPage_create(size_t capacity) {
+  struct CmdPage * page = alias_malloc(alias_default_MemoryCB(), sizeof(*page) + capacity, alignof(struct CmdPage));
+  page->next = NULL;
+  page->capacity = capacity;
+  page->used = 0;
+  atomic_fetch_add_explicit(&_stats.pages, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&_stats.page_bytes, capacity, memory_order_relaxed);
+  return page;
+}
+
 struct Cmd * _CmdBuf_allocate(struct CmdBuf * cbuf, size_t size) {
-  if(cbuf->pointer + size > cbuf->end) {
-    size_t new_capacity = (size + (cbuf->end - cbuf->start));
-    new_capacity += new_capacity >> 1;
-    void * start = realloc(cbuf->start, new_capacity);
-    size_t offset = cbuf->pointer - cbuf->start;
-    cbuf->start = start;
-    cbuf->pointer = start + offset;
-    cbuf->end = start + new_capacity;
-  }
-  struct Cmd * cmd = (struct Cmd *)cbuf->pointer;
+  size = (size + alignof(struct Cmd) - 1) & ~(alignof(struct Cmd) - 1);
+
+  // pages after current are left over from an earlier recording, only the ones skipped for being too small are
+  // passed over empty
+  struct CmdPage * page = cbuf->current;
+  while(page != NULL && page->used + size > page->capacity) {
+    page = page->next;
+    if(page != NULL) {
+      page->used = 0;
+    }
+  }
+
+  if(page == NULL) {
+    page = _CmdPage_create(alias_max(CMD_PAGE_SIZE, size));
+    if(cbuf->current != NULL) {
+      page->next = cbuf->current->next;
+      cbuf->current->next = page;
+    } else {
+      page->next = cbuf->pages;
+      cbuf->pages = page;
+    }
+  }
+
+  cbuf->current = page;
+  struct Cmd * cmd = (struct Cmd *)(page->data + page->used);
   cmd->size = size;
-  cbuf->pointer += size;
+  page->used += size;
+  cbuf->size += size;
+  cbuf->num_commands++;
   return cmd;
 }
 
@@ -24,6 +88,7 @@ void CmdBuf_add_component(struct CmdBuf * cbuf, alias_ecs_EntityHandle entity, a
   cmd->tag = cmd_add_component;
   cmd->entity = entity;
   cmd->component = component;
+  cmd->data_size = data_size;
   memcpy(cmd + 1, data, data_size);
 }
 
@@ -40,28 +105,502 @@ void CmdBuf_despawn(struct CmdBuf * cbuf, alias_ecs_EntityHandle entity) {
   cmd->entity = entity;
 }
 
+// the channel, then the payload on the next 16 bytes
+struct CmdPublish {
+  _Alignas(16) struct EventChannel * channel;
+};
+
+void * CmdBuf_publish(struct CmdBuf * cbuf, struct EventChannel * channel) {
+  struct Cmd * cmd = _CmdBuf_allocate(cbuf, sizeof(*cmd) + sizeof(struct CmdPublish) + channel->size);
+  cmd->tag = cmd_publish;
+  cmd->entity = ALIAS_ECS_INVALID_ENTITY;
+  ((struct CmdPublish *)(cmd + 1))->channel = channel;
+  cbuf->num_publishes++;
+  return (struct CmdPublish *)(cmd + 1) + 1;
+}
+
+// a spawn is the header, one entry per component sorted by handle and then the component data. the sort makes every
+// spawn with the same components look the same so they can go into one alias_ecs_spawn
+struct CmdSpawnComponent {
+  alias_ecs_ComponentHandle component;
+  uint32_t size;
+  uint32_t offset; // from the struct Cmd
+};
+
+struct CmdSpawn {
+  alias_ecs_LayerHandle layer;
+  uint32_t num_components;
+  struct CmdSpawnComponent components[];
+};
+
+alias_ecs_EntityHandle CmdBuf_spawn(struct CmdBuf * cbuf, alias_ecs_LayerHandle layer, uint32_t num_components, const alias_ecs_EntitySpawnComponent * components) {
+  size_t size = sizeof(struct Cmd) + sizeof(struct CmdSpawn) + sizeof(struct CmdSpawnComponent) * num_components;
+  for(uint32_t i = 0; i < num_components; i++) {
+    size = (size + 15) & ~(size_t)15;
+    size += components[i].stride;
+  }
+
+  if(cbuf->id == 0) {
+    cbuf->id = atomic_fetch_add_explicit(&_cmd_next_id, 1, memory_order_relaxed) % CMD_PLACEHOLDER_MAX_ID + 1;
+  }
+
+  struct Cmd * cmd = _CmdBuf_allocate(cbuf, size);
+  cmd->tag = cmd_spawn;
+  cmd->entity = CMD_PLACEHOLDER_BIT | (alias_ecs_EntityHandle)cbuf->id << CMD_PLACEHOLDER_ID_SHIFT | cbuf->num_spawns++;
+
+  struct CmdSpawn * spawn = (struct CmdSpawn *)(cmd + 1);
+  spawn->layer = layer;
+  spawn->num_components = num_components;
+
+  size_t offset = sizeof(struct Cmd) + sizeof(struct CmdSpawn) + sizeof(struct CmdSpawnComponent) * num_components;
+  for(uint32_t i = 0; i < num_components; i++) {
+    offset = (offset + 15) & ~(size_t)15;
+    struct CmdSpawnComponent entry = { .component = components[i].component, .size = components[i].stride, .offset = offset };
+    memcpy((uint8_t *)cmd + offset, components[i].data, entry.size);
+    offset += entry.size;
+
+    uint32_t j = i;
+    while(j > 0 && spawn->components[j - 1].component > entry.component) {
+      spawn->components[j] = spawn->components[j - 1];
+      j--;
+    }
+    spawn->components[j] = entry;
+  }
+
+  return cmd->entity;
+}
+
 void CmdBuf_begin_recording(struct CmdBuf * cbuf) {
-  cbuf->pointer = cbuf->start;
+  cbuf->current = cbuf->pages;
+  if(cbuf->current != NULL) {
+    cbuf->current->used = 0;
+  }
+  cbuf->num_spawns = 0;
+  cbuf->num_publishes = 0;
+  cbuf->num_commands = 0;
+  cbuf->size = 0;
 }
 
+// pages after current are stale, they are emptied so a later recording starts them clean
 void CmdBuf_end_recording(struct CmdBuf * cbuf) {
-  cbuf->end = cbuf->pointer;
+  if(cbuf->current == NULL) {
+    return;
+  }
+  for(struct CmdPage * page = cbuf->current->next; page != NULL; page = page->next) {
+    page->used = 0;
+  }
+}
+
+struct CmdBufStats CmdBuf_stats(void) {
+  return (struct CmdBufStats) {
+      .pages = atomic_load_explicit(&_stats.pages, memory_order_relaxed)
+    , .page_bytes = atomic_load_explicit(&_stats.page_bytes, memory_order_relaxed)
+    , .high_water_bytes = _stats.high_water_bytes
+    , .high_water_commands = _stats.high_water_commands
+    };
+}
+
+// commands are applied grouped by entity and component instead of in recording order. each group is replayed against
+// whether the entity has the component now, adding to an entity that has it and removing from one that lacks it both
+// fail, and only the net change is applied: one add, one remove, or for a component that is removed and added back
+// either an overwrite in place or the remove and then the add. the overwrite keeps the entity where it is and is only
+// used for components without init or cleanup, anything else sees the real remove and add so its callbacks run.
+// entities that are despawned lose every other command and are despawned together in one call at the end. only the
+// order across entities changes, which is sorted and so the same every run
+struct CmdRef {
+  alias_ecs_EntityHandle entity;
+  bool despawn; // sorts after every component command of its entity
+  alias_ecs_ComponentHandle component;
+  uint32_t index;
+  const struct Cmd * cmd;
+};
+
+struct CmdSpawnRef {
+  const struct Cmd * cmd;
+  uint32_t group;
+  uint32_t ordinal;
+};
+
+// open addressing on the spawn's archetype, spawn is NULL when the slot is empty
+struct CmdSpawnGroup {
+  const struct CmdSpawn * spawn;
+  uint32_t hash;
+  uint32_t group;
+};
+
+// execute runs on the loop thread, the scratch is kept between calls
+static struct {
+  uint32_t capacity;
+  struct CmdRef * refs;
+  alias_ecs_EntityHandle * despawns;
+  struct CmdSpawnRef * spawns;
+  alias_ecs_EntityHandle * spawned; // by placeholder
+  alias_ecs_EntityHandle * handles;
+
+  uint32_t groups_capacity;
+  struct CmdSpawnGroup * groups;
+
+  size_t columns_capacity;
+  uint8_t * columns;
+} _execute;
+
+// the spawn ordinal of a placeholder made by cbuf, UINT32_MAX for one from another buffer or past its spawns
+static uint32_t _CmdBuf_ordinal(const struct CmdBuf * cbuf, alias_ecs_EntityHandle placeholder) {
+  uint32_t id = (uint32_t)((placeholder & ~CMD_PLACEHOLDER_BIT) >> CMD_PLACEHOLDER_ID_SHIFT);
+  uint32_t ordinal = (uint32_t)placeholder;
+  assert(id == cbuf->id && "placeholder used outside of the buffer that spawned it");
+  return id == cbuf->id && ordinal < cbuf->num_spawns ? ordinal : UINT32_MAX;
+}
+
+static int _CmdRef_compare(const void * ap, const void * bp) {
+  const struct CmdRef * a = (const struct CmdRef *)ap, * b = (const struct CmdRef *)bp;
+  if(a->entity != b->entity) {
+    return a->entity < b->entity ? -1 : 1;
+  }
+  if(a->despawn != b->despawn) {
+    return a->despawn ? 1 : -1;
+  }
+  if(a->component != b->component) {
+    return a->component < b->component ? -1 : 1;
+  }
+  return (a->index > b->index) - (a->index < b->index);
+}
+
+// one entity and component, commands in recording order
+static void _CmdBuf_execute_component(alias_ecs_Instance * instance, const struct CmdRef * refs, uint32_t count) {
+  alias_ecs_EntityHandle entity = refs[0].entity;
+  alias_ecs_ComponentHandle component = refs[0].component;
+
+  const void * data;
+  bool had = alias_ecs_read_entity_component(instance, entity, component, &data) == ALIAS_ECS_SUCCESS;
+  bool has = had, removed = false;
+  const struct Cmd * add = NULL;
+  for(uint32_t i = 0; i < count; i++) {
+    if(refs[i].cmd->tag == cmd_add_component && !has) {
+      has = true;
+      add = refs[i].cmd;
+    } else if(refs[i].cmd->tag == cmd_remove_component && has) {
+      has = false;
+      removed = removed || had;
+      add = NULL;
+    }
+  }
+
+  if(removed && add != NULL && Engine_component_is_plain(component)) {
+    void * write;
+    if(alias_ecs_write_entity_component(instance, entity, component, &write) == ALIAS_ECS_SUCCESS) {
+      memcpy(write, add + 1, add->data_size);
+    }
+  } else if(removed && add != NULL) {
+    alias_ecs_remove_component_from_entity(instance, entity, component);
+    alias_ecs_add_component_to_entity(instance, entity, component, add + 1);
+  } else if(removed) {
+    alias_ecs_remove_component_from_entity(instance, entity, component);
+  } else if(add != NULL) {
+    alias_ecs_add_component_to_entity(instance, entity, component, add + 1);
+  }
+}
+
+static int _CmdSpawnRef_compare(const void * ap, const void * bp) {
+  const struct CmdSpawnRef * a = (const struct CmdSpawnRef *)ap, * b = (const struct CmdSpawnRef *)bp;
+  if(a->group != b->group) {
+    return a->group < b->group ? -1 : 1;
+  }
+  return (a->ordinal > b->ordinal) - (a->ordinal < b->ordinal);
+}
+
+static bool _CmdSpawn_same(const struct CmdSpawn * a, const struct CmdSpawn * b) {
+  if(a->layer != b->layer || a->num_components != b->num_components) {
+    return false;
+  }
+  for(uint32_t i = 0; i < a->num_components; i++) {
+    if(a->components[i].component != b->components[i].component || a->components[i].size != b->components[i].size) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// fnv-1a over what _CmdSpawn_same compares
+static uint32_t _CmdSpawn_hash(const struct CmdSpawn * spawn) {
+  uint32_t hash = 2166136261u;
+  #define MIX(X) hash = (hash ^ (uint32_t)(X)) * 16777619u;
+  MIX(spawn->layer)
+  MIX(spawn->num_components)
+  for(uint32_t i = 0; i < spawn->num_components; i++) {
+    MIX(spawn->components[i].component)
+    MIX(spawn->components[i].size)
+  }
+  #undef MIX
+  return hash;
+}
+
+// placeholders already marked dead are skipped. spawns with the same components gather their data into columns and
+// go in one alias_ecs_spawn, groups in order of their first spawn. a spawn that fails leaves its placeholders dead
+static void _CmdBuf_execute_spawns(const struct CmdBuf * cbuf, alias_ecs_Instance * instance) {
+  // at most half full
+  uint32_t groups_capacity = 16;
+  while(groups_capacity < cbuf->num_spawns * 2) {
+    groups_capacity *= 2;
+  }
+  if(groups_capacity > _execute.groups_capacity) {
+    CMD_GROW(_execute.groups, _execute.groups_capacity, groups_capacity);
+    _execute.groups_capacity = groups_capacity;
+  }
+  alias_memory_clear(_execute.groups, sizeof(*_execute.groups) * groups_capacity);
+
+  uint32_t num_spawns = 0, num_groups = 0;
+  CMD_BUF_EACH(cbuf, cmd) {
+    if(cmd->tag != cmd_spawn) {
+      continue;
+    }
+    uint32_t ordinal = (uint32_t)cmd->entity;
+    if(_execute.spawned[ordinal] == ALIAS_ECS_INVALID_ENTITY) {
+      continue;
+    }
+    const struct CmdSpawn * spawn = (const struct CmdSpawn *)(cmd + 1);
+    uint32_t hash = _CmdSpawn_hash(spawn);
+    uint32_t slot = hash & (groups_capacity - 1);
+    while(_execute.groups[slot].spawn != NULL
+       && (_execute.groups[slot].hash != hash || !_CmdSpawn_same(_execute.groups[slot].spawn, spawn))
+        ) {
+      slot = (slot + 1) & (groups_capacity - 1);
+    }
+    if(_execute.groups[slot].spawn == NULL) {
+      _execute.groups[slot] = (struct CmdSpawnGroup) { .spawn = spawn, .hash = hash, .group = num_groups++ };
+    }
+    _execute.spawns[num_spawns++] = (struct CmdSpawnRef) { .cmd = cmd, .group = _execute.groups[slot].group, .ordinal = ordinal };
+  }
+  qsort(_execute.spawns, num_spawns, sizeof(*_execute.spawns), _CmdSpawnRef_compare);
+
+  uint32_t start = 0;
+  while(start < num_spawns) {
+    uint32_t end = start + 1;
+    while(end < num_spawns && _execute.spawns[end].group == _execute.spawns[start].group) {
+      end++;
+    }
+    uint32_t count = end - start;
+    const struct CmdSpawn * spawn = (const struct CmdSpawn *)(_execute.spawns[start].cmd + 1);
+
+    size_t columns_size = 0;
+    for(uint32_t c = 0; c < spawn->num_components; c++) {
+      columns_size += ((size_t)spawn->components[c].size * count + 15) & ~(size_t)15;
+    }
+    if(columns_size > _execute.columns_capacity) {
+      // columns are only ever filled from scratch, nothing to keep
+      if(_execute.columns != NULL) {
+        alias_free(alias_default_MemoryCB(), _execute.columns, _execute.columns_capacity, 16);
+      }
+      _execute.columns_capacity = columns_size + (columns_size >> 1);
+      _execute.columns = alias_malloc(alias_default_MemoryCB(), _execute.columns_capacity, 16);
+    }
+
+    alias_ecs_EntitySpawnComponent components[spawn->num_components + 1];
+    uint8_t * column = _execute.columns;
+    for(uint32_t c = 0; c < spawn->num_components; c++) {
+      uint32_t size = spawn->components[c].size;
+      for(uint32_t i = 0; i < count; i++) {
+        const struct Cmd * cmd = _execute.spawns[start + i].cmd;
+        const struct CmdSpawn * other = (const struct CmdSpawn *)(cmd + 1);
+        memcpy(column + (size_t)size * i, (const uint8_t *)cmd + other->components[c].offset, size);
+      }
+      components[c] = (alias_ecs_EntitySpawnComponent) { .component = spawn->components[c].component, .stride = size, .data = size ? column : NULL };
+      column += ((size_t)size * count + 15) & ~(size_t)15;
+    }
+
+    alias_ecs_Result result = alias_ecs_spawn(instance, &(alias_ecs_EntitySpawnInfo) {
+        .layer = spawn->layer
+      , .count = count
+      , .num_components = spawn->num_components
+      , .components = components
+      }, _execute.handles);
+    if(result != ALIAS_ECS_SUCCESS) {
+      ALIAS_ERROR("could not spawn %u entities from a command buffer", count);
+    }
+
+    for(uint32_t i = 0; i < count; i++) {
+      _execute.spawned[_execute.spawns[start + i].ordinal] = result == ALIAS_ECS_SUCCESS ? _execute.handles[i] : ALIAS_ECS_INVALID_ENTITY;
+    }
+
+    start = end;
+  }
 }
 
 void CmdBuf_execute(struct CmdBuf * cbuf, alias_ecs_Instance * instance) {
-  struct Cmd * cmd = (struct Cmd *)cbuf->start;
-  while((void *)cmd < cbuf->end) {
-    switch(cmd->tag) {
-    case cmd_add_component:
-      alias_ecs_add_component_to_entity(instance, cmd->entity, cmd->component, cmd + 1);
-      break;
-    case cmd_remove_component:
-      alias_ecs_remove_component_from_entity(instance, cmd->entity, cmd->component);
-      break;
-    case cmd_despawn:
-      alias_ecs_despawn(instance, 1, &cmd->entity);
-      break;
-    }
-    cmd = (struct Cmd *)((uint8_t *)cmd + cmd->size);
+  uint32_t count = cbuf->num_commands;
+  if(count == 0) {
+    return;
+  }
+  _stats.high_water_bytes = alias_max(_stats.high_water_bytes, cbuf->size);
+  _stats.high_water_commands = alias_max(_stats.high_water_commands, count);
+
+  if(count > _execute.capacity) {
+    uint32_t capacity = count + (count >> 1);
+    CMD_GROW(_execute.refs, _execute.capacity, capacity);
+    CMD_GROW(_execute.despawns, _execute.capacity, capacity);
+    CMD_GROW(_execute.spawns, _execute.capacity, capacity);
+    CMD_GROW(_execute.spawned, _execute.capacity, capacity);
+    CMD_GROW(_execute.handles, _execute.capacity, capacity);
+    _execute.capacity = capacity;
+  }
+
+  // spawns first so placeholders resolve, a placeholder despawned in the same buffer is never spawned at all
+  if(cbuf->num_spawns > 0) {
+    alias_memory_clear(_execute.spawned, sizeof(*_execute.spawned) * cbuf->num_spawns);
+    CMD_BUF_EACH(cbuf, cmd) {
+      if(cmd->tag == cmd_despawn && CmdBuf_is_placeholder(cmd->entity)) {
+        uint32_t ordinal = _CmdBuf_ordinal(cbuf, cmd->entity);
+        if(ordinal != UINT32_MAX) {
+          _execute.spawned[ordinal] = ALIAS_ECS_INVALID_ENTITY;
+        }
+      }
+    }
+    _CmdBuf_execute_spawns(cbuf, instance);
+  }
+
+  uint32_t index = 0;
+  count = 0;
+  CMD_BUF_EACH(cbuf, cmd) {
+    uint32_t cmd_index = index++;
+    alias_ecs_EntityHandle entity = cmd->entity;
+    if(cmd->tag == cmd_spawn || cmd->tag == cmd_publish) {
+      continue;
+    }
+    if(CmdBuf_is_placeholder(entity)) {
+      uint32_t ordinal = _CmdBuf_ordinal(cbuf, entity);
+      entity = ordinal != UINT32_MAX ? _execute.spawned[ordinal] : ALIAS_ECS_INVALID_ENTITY;
+      if(entity == ALIAS_ECS_INVALID_ENTITY) {
+        continue;
+      }
+    }
+    _execute.refs[count++] = (struct CmdRef) {
+        .entity = entity
+      , .despawn = cmd->tag == cmd_despawn
+      , .component = cmd->tag == cmd_despawn ? ALIAS_ECS_INVALID_COMPONENT : cmd->component
+      , .index = cmd_index
+      , .cmd = cmd
+      };
+  }
+  qsort(_execute.refs, count, sizeof(*_execute.refs), _CmdRef_compare);
+
+  uint32_t num_despawns = 0;
+  uint32_t start = 0;
+  while(start < count) {
+    alias_ecs_EntityHandle entity = _execute.refs[start].entity;
+    uint32_t end = start + 1;
+    while(end < count && _execute.refs[end].entity == entity) {
+      end++;
+    }
+
+    if(_execute.refs[end - 1].despawn) {
+      _execute.despawns[num_despawns++] = entity;
+    } else {
+      uint32_t run = start;
+      while(run < end) {
+        uint32_t run_end = run + 1;
+        while(run_end < end && _execute.refs[run_end].component == _execute.refs[run].component) {
+          run_end++;
+        }
+        _CmdBuf_execute_component(instance, _execute.refs + run, run_end - run);
+        run = run_end;
+      }
+    }
+
+    start = end;
+  }
+
+  // one stale entity fails the whole batch, then they go one at a time so the rest still go
+  if(num_despawns > 0 && alias_ecs_despawn(instance, num_despawns, _execute.despawns) != ALIAS_ECS_SUCCESS) {
+    for(uint32_t i = 0; i < num_despawns; i++) {
+      alias_ecs_despawn(instance, 1, &_execute.despawns[i]);
+    }
+  }
+
+  // events after the structural changes, in recording order
+  if(cbuf->num_publishes > 0) {
+    CMD_BUF_EACH(cbuf, cmd) {
+      if(cmd->tag == cmd_publish) {
+        const struct CmdPublish * publish = (const struct CmdPublish *)(cmd + 1);
+        memcpy(EventChannel_append(publish->channel), publish + 1, publish->channel->size);
+      }
+    }
+  }
+
+  // a ComponentCache filled while the changes went in would otherwise pass as current
+  Engine_ecs_changed();
+}
+
+// ====================================================================================================================
+// Streams ============================================================================================================
+static struct CmdStream _loop_stream;
+
+static _Thread_local struct CmdScope _cmd_scope;
+static _Thread_local struct CmdBuf * _cmd_current;
+
+static struct CmdBuf * _CmdStream_at(struct CmdStream * stream, uint32_t index) {
+  if(index >= stream->capacity) {
+    uint32_t capacity = alias_max(index + 1, stream->capacity + (stream->capacity >> 1) + 4);
+    CMD_GROW(stream->bufs, stream->capacity, capacity);
+    for(uint32_t i = stream->capacity; i < capacity; i++) {
+      stream->bufs[i] = alias_malloc(alias_default_MemoryCB(), sizeof(**stream->bufs), alignof(**stream->bufs));
+      alias_memory_clear(stream->bufs[i], sizeof(**stream->bufs));
+    }
+    stream->capacity = capacity;
+  }
+  if(index >= stream->length) {
+    for(uint32_t i = stream->length; i <= index; i++) {
+      CmdBuf_begin_recording(stream->bufs[i]);
+    }
+    stream->length = index + 1;
+  }
+  return stream->bufs[index];
+}
+
+// makes the calling thread record into the buffer at scope, returns where it recorded before
+struct CmdScope CmdStream_enter(struct CmdScope scope) {
+  struct CmdScope previous = _cmd_scope;
+  _cmd_scope = scope;
+  _cmd_current = scope.stream != NULL ? _CmdStream_at(scope.stream, scope.index) : NULL;
+  return previous;
+}
+
+// count new buffers after the one the calling thread records into, it moves on past them. returns the scope of the
+// first
+struct CmdScope CmdStream_fork(uint32_t count) {
+  if(_cmd_scope.stream == NULL) {
+    // like Engine_cmd_buf, a job outside of a system has no stream to fork and the loop stream is not safe to share
+    assert(Engine_jobs_on_loop());
+    CmdStream_enter((struct CmdScope) { .stream = &_loop_stream, .index = _loop_stream.length ? _loop_stream.length - 1 : 0 });
+  }
+  struct CmdScope first = { .stream = _cmd_scope.stream, .index = _cmd_scope.index + 1 };
+  _CmdStream_at(first.stream, first.index + count);
+  CmdStream_enter((struct CmdScope) { .stream = first.stream, .index = first.index + count });
+  return first;
+}
+
+// applies every buffer in order and starts the stream over
+void CmdStream_execute(struct CmdStream * stream, alias_ecs_Instance * instance) {
+  for(uint32_t i = 0; i < stream->length; i++) {
+    CmdBuf_end_recording(stream->bufs[i]);
+    CmdBuf_execute(stream->bufs[i], instance);
+    CmdBuf_begin_recording(stream->bufs[i]);
+  }
+  stream->length = 0;
+}
+
+// the loop thread buffer, after the systems at every sync point
+void CmdStream_execute_loop(alias_ecs_Instance * instance) {
+  CmdStream_execute(&_loop_stream, instance);
+  if(_cmd_scope.stream == &_loop_stream) {
+    CmdStream_enter((struct CmdScope) { .stream = &_loop_stream, .index = 0 });
+  }
+}
+
+struct CmdBuf * Engine_cmd_buf(void) {
+  if(_cmd_current == NULL) {
+    // a job outside of a system has no buffer of its own, the loop buffer is not safe to share
+    assert(Engine_jobs_on_loop());
+    CmdStream_enter((struct CmdScope) { .stream = &_loop_stream, .index = _loop_stream.length ? _loop_stream.length - 1 : 0 });
   }
+  return _cmd_current;
 }
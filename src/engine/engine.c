@@ -5,16 +5,32 @@
 #include <alias/ui.h>
 #include <alias/data_structure/inline_list.h>
 #include <alias/data_structure/vector.h>
+#include <alias/log.h>
 
 #include <uchar.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define UI_NUM_VERTEXES (1024 * 1024)
 #define UI_NUM_INDEXES  (1024 * 1024)
 #define UI_NUM_GROUPS   1024
 
-static uv_loop_t _loop;
+#define FRAME_HISTORY_LENGTH 256
+#define PHYSICS_TIMESTEP     (1.0f / 60.0f)
+#define FRAME_SPIN_NS        250000 // default for Engine_set_frame_spin_ns
+
+void Jobs_init(void);
+void Jobs_cleanup(void);
+void Trace_cleanup(void);
+void FrameArena_begin(void);
+void FrameArena_cleanup(void);
+void EventChannels_update(void);
+void EventChannels_cleanup(void);
+void Query_cleanup(void);
+void CmdStream_execute_loop(alias_ecs_Instance * instance);
 
-static inline void _frame_timer_f(uv_timer_t * t);
+static uv_loop_t _loop;
 
 static alias_ecs_Instance * _ecs;
 
@@ -53,12 +69,83 @@ static alias_ui_OutputGroup _ui_groups[UI_NUM_GROUPS];
 static bool _ui_recording;
 
 static alias_R _physics_speed;
+static uint32_t _physics_max_substeps;
+static alias_R _physics_interpolation;
 
 static struct State * _current_state;
 
 static uint32_t _screen_width;
 static uint32_t _screen_height;
 
+// components
+static struct ComponentRegistration * _component_registrations = NULL;
+
+// by handle, true for components registered here without init, create, destroy or cleanup. the bundle components are
+// registered by alias and left false
+static alias_Vector(bool) _component_plain = ALIAS_VECTOR_INIT;
+
+// runs before main
+void Engine_add_component_registration(struct ComponentRegistration * registration) {
+  registration->next = _component_registrations;
+  _component_registrations = registration;
+}
+
+struct ComponentRegistration * Component_registrations(void) {
+  return _component_registrations;
+}
+
+bool Engine_try_register_component(const alias_ecs_ComponentCreateInfo * info, alias_ecs_ComponentHandle * handle) {
+  for(uint32_t i = 0; i < info->num_required_components; i++) {
+    if(info->required_components[i] == ALIAS_ECS_INVALID_COMPONENT) {
+      return false;
+    }
+  }
+  if(alias_ecs_register_component(_ecs, info, handle) != ALIAS_ECS_SUCCESS) {
+    ALIAS_ERROR("failed to register component");
+    return true;
+  }
+
+  while(_component_plain.length <= *handle) {
+    alias_Vector_space_for(&_component_plain, alias_default_MemoryCB(), 1);
+    *alias_Vector_push(&_component_plain) = false;
+  }
+  _component_plain.data[*handle] = info->init.fn == NULL && info->create.fn == NULL && info->destroy.fn == NULL
+                                && info->cleanup.fn == NULL;
+  return true;
+}
+
+// a plain component can have its data replaced in place, nothing else sees it come and go
+bool Engine_component_is_plain(alias_ecs_ComponentHandle component) {
+  return component < _component_plain.length && _component_plain.data[component];
+}
+
+static void _register_components(void) {
+  uint32_t remaining = 0;
+  for(struct ComponentRegistration * r = _component_registrations; r != NULL; r = r->next) {
+    remaining++;
+  }
+
+  // every pass registers at least one component unless the requirements are missing or circular
+  while(remaining > 0) {
+    uint32_t registered = 0;
+    for(struct ComponentRegistration * r = _component_registrations; r != NULL; r = r->next) {
+      if(r->try_register != NULL && r->try_register()) {
+        r->try_register = NULL;
+        registered++;
+      }
+    }
+    if(registered == 0) {
+      for(struct ComponentRegistration * r = _component_registrations; r != NULL; r = r->next) {
+        if(r->try_register != NULL) {
+          ALIAS_ERROR("component %s requires a component that never registered", r->name);
+        }
+      }
+      break;
+    }
+    remaining -= registered;
+  }
+}
+
 void Engine_init(uint32_t screen_width, uint32_t screen_height, const char * title, struct State * initial_state) {
   _screen_width = screen_width;
   _screen_height = screen_height;
@@ -67,61 +154,336 @@ void Engine_init(uint32_t screen_width, uint32_t screen_height, const char * tit
 
   alias_ecs_create_instance(NULL, &_ecs);
 
+  alias_TransformBundle_initialize(_ecs, &_engine_transform_bundle);
+  alias_Physics2DBundle_initialize(_ecs, &_engine_physics_2d_bundle, &_engine_transform_bundle);
+  _register_components();
+
   alias_ui_initialize(alias_default_MemoryCB(), &_ui);
   _ui_recording = false;
 
   _physics_speed = alias_R_ONE;
+  _physics_max_substeps = 4;
+  _physics_interpolation = alias_R_ONE;
   _current_state = NULL;
 
   Engine_push_state(initial_state);
 }
 
 static void _update_input(void);
-static void _update_events(void);
 static bool _update_state(void);
 static void _update_physics(void);
 static void _update_display(void);
 
+static void _render_thread_stop(void);
+
+static uint64_t _profile_phase(enum ProfilePhase phase, uint64_t start);
+static void _profile_end_frame(void);
+static void _profile_overlay(void);
+
+static bool _input_replay_frame(void);
+static void _input_record_step(void);
+
 static bool _update(void) {
+  FrameArena_begin();
+
+  uint64_t t = uv_hrtime();
   _update_physics();
+  t = _profile_phase(ProfilePhase_Physics, t);
   _update_display();
+  t = _profile_phase(ProfilePhase_Display, t);
+  Backend_poll_events();
   if(Backend_should_exit()) {
     return false;
   }
   _update_input();
-  _update_events();
-  return _update_state();
+  t = _profile_phase(ProfilePhase_Input, t);
+  EventChannels_update();
+  t = _profile_phase(ProfilePhase_Events, t);
+  bool running = _update_state();
+  CmdStream_execute_loop(Engine_ecs());
+  _profile_phase(ProfilePhase_State, t);
+  _profile_overlay();
+  _profile_end_frame();
+  return running;
 }
 
 uv_loop_t * Engine_uv_loop(void) {
   return &_loop;
 }
 
-void Engine_run(void) {
-  uv_timer_t _frame_timer;
+// ====================================================================================================================
+// Frame Pacing =======================================================================================================
+// each frame has a deadline one period after the last. the loop sleeps in a timer until the deadline is within the spin
+// window and spins off the rest, a frame that misses its deadline moves the deadline instead of queuing up more
+// frames. the timer counts whole milliseconds on a clock that can run behind uv_hrtime, so a wake up that is still
+// outside the window sleeps again instead of spinning.
+static uv_timer_t _frame_timer;
+static uint64_t _frame_spin_ns = FRAME_SPIN_NS;
+static uint64_t _frame_deadline;
+static uint64_t _frame_start;
+static alias_R _frame_time;
+static uint64_t _frame_history[FRAME_HISTORY_LENGTH];
+static uint32_t _frame_history_count = 0;
+
+static void _frame_timer_f(uv_timer_t * t);
+
+// rounded up so the timer never wakes before the spin window
+static void _frame_sleep(uint64_t now) {
+  uint64_t remaining = _frame_deadline > now ? _frame_deadline - now : 0;
+  uint64_t sleep_ms = remaining > _frame_spin_ns ? (remaining - _frame_spin_ns + 999999) / 1000000 : 0;
+
+  uv_update_time(&_loop);
+  uv_timer_start(&_frame_timer, _frame_timer_f, sleep_ms, 0);
+}
 
-  uv_loop_init(&_loop);
+static void _frame_schedule(void) {
+  uint32_t fps = Backend_get_target_fps();
+  uint64_t now = uv_hrtime();
 
-  uv_timer_init(&_loop, &_frame_timer);
-  uv_timer_start(&_frame_timer, _frame_timer_f, 0, 16);
-  
-  uv_run(&_loop, UV_RUN_DEFAULT);
+  if(fps == 0) {
+    _frame_deadline = now;
+  } else {
+    _frame_deadline += 1000000000ull / fps;
+    if(_frame_deadline < now) {
+      _frame_deadline = now;
+    }
+  }
+
+  _frame_sleep(now);
 }
 
-static inline void _frame_timer_f(uv_timer_t * t) {
+static void _frame_timer_f(uv_timer_t * t) {
+  (void)t;
+
+  uint64_t now = uv_hrtime();
+  if(now + _frame_spin_ns < _frame_deadline) {
+    _frame_sleep(now);
+    return;
+  }
+
+  TRACE_ZONE("frame");
+
+  while(now < _frame_deadline) {
+    now = uv_hrtime();
+  }
+
+  _frame_history[_frame_history_count++ % FRAME_HISTORY_LENGTH] = now - _frame_start;
+  alias_R fixed_frame_time = Backend_get_frame_time();
+  _frame_time = fixed_frame_time > 0 ? fixed_frame_time : (alias_R)(now - _frame_start) / 1000000000.0;
+  _frame_start = now;
+
+  // a replay drives the frame time, the game ends with it
+  if(Engine_replaying_input() && !_input_replay_frame()) {
+    uv_stop(&_loop);
+    return;
+  }
+  _input_record_step();
+
   if(!_update()) {
     uv_stop(&_loop);
+    return;
   }
+
+  _frame_schedule();
+}
+
+uint32_t Engine_target_fps(void) {
+  return Backend_get_target_fps();
+}
+
+void Engine_set_target_fps(uint32_t fps) {
+  Backend_set_target_fps(fps);
+}
+
+uint64_t Engine_frame_spin_ns(void) {
+  return _frame_spin_ns;
+}
+
+void Engine_set_frame_spin_ns(uint64_t spin_ns) {
+  _frame_spin_ns = spin_ns;
+}
+
+static int _frame_history_compare(const void * ap, const void * bp) {
+  uint64_t a = *(const uint64_t *)ap;
+  uint64_t b = *(const uint64_t *)bp;
+  return (a > b) - (a < b);
+}
+
+alias_R Engine_frame_time_percentile(alias_R percentile) {
+  uint64_t sorted[FRAME_HISTORY_LENGTH];
+  uint32_t count = alias_min(_frame_history_count, FRAME_HISTORY_LENGTH);
+
+  if(count == 0) {
+    return alias_R_ZERO;
+  }
+
+  alias_memory_copy(sorted, sizeof(sorted), _frame_history, sizeof(*sorted) * count);
+  qsort(sorted, count, sizeof(*sorted), _frame_history_compare);
+
+  percentile = alias_max(alias_R_ZERO, alias_min(alias_R_ONE, percentile));
+  uint32_t index = (uint32_t)(percentile * (count - 1) + 0.5f);
+
+  return (alias_R)sorted[index] / 1000000000.0;
+}
+
+// =====================================================================================================================
+// Profile =============================================================================================================
+// each phase accumulates its time over a frame, including every camera for the draw phases. finished frames go into a
+// ring the size of the frame history.
+static uint64_t _profile_current[ProfilePhase_COUNT];
+static uint64_t _profile_history[FRAME_HISTORY_LENGTH][ProfilePhase_COUNT];
+static uint32_t _profile_history_count = 0;
+static bool _profile_overlay_enabled = false;
+
+static const char * _profile_names[ProfilePhase_COUNT] = {
+    [ProfilePhase_Physics] = "physics"
+  , [ProfilePhase_Display] = "display"
+  , [ProfilePhase_DrawSprites] = "  sprites"
+  , [ProfilePhase_DrawRectangles] = "  rectangles"
+  , [ProfilePhase_DrawCircles] = "  circles"
+  , [ProfilePhase_DrawText] = "  text"
+  , [ProfilePhase_UI] = "  ui"
+  , [ProfilePhase_Input] = "input"
+  , [ProfilePhase_Events] = "events"
+  , [ProfilePhase_State] = "state"
+};
+
+// adds the time since start to the phase, returns now so phases can be chained
+static uint64_t _profile_phase(enum ProfilePhase phase, uint64_t start) {
+  uint64_t now = uv_hrtime();
+  _profile_current[phase] += now - start;
+  return now;
+}
+
+static void _profile_end_frame(void) {
+  uint64_t * frame = _profile_history[_profile_history_count++ % FRAME_HISTORY_LENGTH];
+  alias_memory_copy(frame, sizeof(*frame) * ProfilePhase_COUNT, _profile_current, sizeof(_profile_current));
+  alias_memory_clear(_profile_current, sizeof(_profile_current));
+}
+
+static uint32_t _profile_sorted(enum ProfilePhase phase, uint64_t * sorted) {
+  uint32_t count = alias_min(_profile_history_count, FRAME_HISTORY_LENGTH);
+  for(uint32_t i = 0; i < count; i++) {
+    sorted[i] = _profile_history[i][phase];
+  }
+  qsort(sorted, count, sizeof(*sorted), _frame_history_compare);
+  return count;
+}
+
+const char * Engine_profile_name(enum ProfilePhase phase) {
+  return phase < ProfilePhase_COUNT ? _profile_names[phase] : "";
+}
+
+alias_R Engine_profile_min(enum ProfilePhase phase) {
+  uint64_t sorted[FRAME_HISTORY_LENGTH];
+  uint32_t count = _profile_sorted(phase, sorted);
+  return count ? (alias_R)sorted[0] / 1000000000.0 : alias_R_ZERO;
+}
+
+alias_R Engine_profile_avg(enum ProfilePhase phase) {
+  uint32_t count = alias_min(_profile_history_count, FRAME_HISTORY_LENGTH);
+  uint64_t total = 0;
+  for(uint32_t i = 0; i < count; i++) {
+    total += _profile_history[i][phase];
+  }
+  return count ? (alias_R)total / count / 1000000000.0 : alias_R_ZERO;
+}
+
+alias_R Engine_profile_p99(enum ProfilePhase phase) {
+  uint64_t sorted[FRAME_HISTORY_LENGTH];
+  uint32_t count = _profile_sorted(phase, sorted);
+  return count ? (alias_R)sorted[(uint32_t)(0.99f * (count - 1) + 0.5f)] / 1000000000.0 : alias_R_ZERO;
+}
+
+bool Engine_profile_overlay(void) {
+  return _profile_overlay_enabled;
+}
+
+void Engine_set_profile_overlay(bool enabled) {
+  _profile_overlay_enabled = enabled;
+}
+
+// recorded after the state so it draws over it, with the next display
+static void _profile_overlay(void) {
+  static const char ramp[] = " .:-=+*#";
+  char history[65];
+
+  if(!_profile_overlay_enabled) {
+    return;
+  }
+
+  // the most recent frame times, scaled against the slowest of them
+  uint32_t count = alias_min(_frame_history_count, sizeof(history) - 1);
+  uint64_t slowest = 1;
+  for(uint32_t i = 0; i < count; i++) {
+    slowest = alias_max(slowest, _frame_history[(_frame_history_count - count + i) % FRAME_HISTORY_LENGTH]);
+  }
+  for(uint32_t i = 0; i < count; i++) {
+    uint64_t time = _frame_history[(_frame_history_count - count + i) % FRAME_HISTORY_LENGTH];
+    history[i] = ramp[time * (sizeof(ramp) - 2) / slowest];
+  }
+  history[count] = 0;
+
+  Engine_ui_top_right();
+  Engine_ui_vertical(); {
+    Engine_ui_font_size(14);
+    Engine_ui_font_color(alias_Color_BLACK);
+    Engine_ui_text("frame %.2f ms  p99 %.2f ms", Engine_frame_time() * 1000, Engine_frame_time_percentile(0.99f) * 1000);
+    Engine_ui_text("[%s]", history);
+    Engine_ui_text("phase  min / avg / p99 ms");
+    for(uint32_t phase = 0; phase < ProfilePhase_COUNT; phase++) {
+      Engine_ui_text("%s  %.2f / %.2f / %.2f"
+        , _profile_names[phase]
+        , Engine_profile_min(phase) * 1000
+        , Engine_profile_avg(phase) * 1000
+        , Engine_profile_p99(phase) * 1000
+        );
+    }
+
+    struct CmdBufStats cmds = CmdBuf_stats();
+    Engine_ui_text("cmd pages %llu (%llu kb)  peak %llu kb / %llu"
+      , (unsigned long long)cmds.pages
+      , (unsigned long long)(cmds.page_bytes >> 10)
+      , (unsigned long long)(cmds.high_water_bytes >> 10)
+      , (unsigned long long)cmds.high_water_commands
+      );
+  } Engine_ui_end();
+}
+
+void Engine_run(void) {
+  uv_loop_init(&_loop);
+  Jobs_init();
+
+  uint32_t fps = Backend_get_target_fps();
+  _frame_deadline = uv_hrtime();
+  _frame_start = _frame_deadline - (fps ? 1000000000ull / fps : 0);
+
+  uv_timer_init(&_loop, &_frame_timer);
+  uv_timer_start(&_frame_timer, _frame_timer_f, 0, 0);
+
+  uv_run(&_loop, UV_RUN_DEFAULT);
+
+  _render_thread_stop();
+  Jobs_cleanup();
+  Engine_stop_input_recording();
+  Engine_stop_input_replay();
+  Backend_cleanup();
+  FrameArena_cleanup();
+  EventChannels_cleanup();
+  Query_cleanup();
+  Trace_cleanup();
 }
 
 // state
 void Engine_push_state(struct State * state) {
   if(_current_state != NULL && _current_state->pause != NULL) {
+    TRACE_ZONE("state pause");
     _current_state->pause(_current_state->ud);
   }
   state->prev = _current_state;
   _current_state = state;
   if(state->begin != NULL) {
+    TRACE_ZONE("state begin");
     state->begin(state->ud);
   }
 }
@@ -131,10 +493,12 @@ void Engine_pop_state(void) {
     return;
   }
   if(_current_state->end != NULL) {
+    TRACE_ZONE("state end");
     _current_state->end(_current_state->ud);
   }
   _current_state = _current_state->prev;
   if(_current_state != NULL && _current_state->unpause != NULL) {
+    TRACE_ZONE("state unpause");
     _current_state->unpause(_current_state->ud);
   }
 }
@@ -144,11 +508,17 @@ static bool _update_state(void) {
   if(current == NULL) {
     return false;
   }
+  if(current->num_systems > 0) {
+    TRACE_ZONE("state systems");
+    Engine_run_systems(current->num_systems, current->systems, &current->schedule);
+  }
   if(current != NULL && current->frame != NULL) {
+    TRACE_ZONE("state frame");
     current->frame(current->ud);
   }
   while(current != NULL) {
     if(current->background != NULL) {
+      TRACE_ZONE("state background");
       current->background(current->ud);
     }
     current = current->prev;
@@ -157,6 +527,8 @@ static bool _update_state(void) {
 }
 
 // parameter access
+uint64_t _engine_ecs_generation = 1; // zeroed caches start out stale
+
 alias_ecs_Instance * Engine_ecs(void) {
   return _ecs;
 }
@@ -223,7 +595,154 @@ void Engine_remove_input_frontend(uint32_t player_index, uint32_t index) {
   }
 }
 
-static void _update_input(void) {
+// input recording
+// a recording is a header followed by one record per frame: the frame time and the bindings that changed since the
+// previous frame. values are written in host byte order. the recording keeps the real frame time and a replay runs
+// every frame with the recorded one, so the fixed physics steps come out the same as they did live
+//   header: "AIR1", uint32_t binding_count
+//   frame:  float frame_time, uint16_t num_changed, num_changed x { uint16_t binding, float value }
+static const char _input_recording_magic[4] = { 'A', 'I', 'R', '1' };
+
+static struct {
+  FILE * file;
+  alias_R * previous;
+  alias_R time;
+} _input_record = { 0 };
+
+static struct {
+  FILE * file;
+  alias_R time;
+} _input_replay = { 0 };
+
+bool Engine_record_input(const char * path) {
+  Engine_stop_input_recording();
+
+  _input_record.file = fopen(path, "wb");
+  if(_input_record.file == NULL) {
+    ALIAS_ERROR("could not open input recording %s", path);
+    return false;
+  }
+
+  uint32_t binding_count = _input_binding_count;
+  fwrite(_input_recording_magic, sizeof(_input_recording_magic), 1, _input_record.file);
+  fwrite(&binding_count, sizeof(binding_count), 1, _input_record.file);
+
+  _input_record.previous = alias_malloc(alias_default_MemoryCB(), sizeof(*_input_record.previous) * _input_binding_count, alignof(*_input_record.previous));
+  alias_memory_clear(_input_record.previous, sizeof(*_input_record.previous) * _input_binding_count);
+  _input_record.time = alias_R_ZERO;
+
+  return true;
+}
+
+void Engine_stop_input_recording(void) {
+  if(_input_record.file == NULL) {
+    return;
+  }
+  fclose(_input_record.file);
+  alias_free(alias_default_MemoryCB(), _input_record.previous, sizeof(*_input_record.previous) * _input_binding_count, alignof(*_input_record.previous));
+  _input_record.file = NULL;
+  _input_record.previous = NULL;
+}
+
+bool Engine_replay_input(const char * path) {
+  Engine_stop_input_replay();
+
+  FILE * file = fopen(path, "rb");
+  if(file == NULL) {
+    ALIAS_ERROR("could not open input recording %s", path);
+    return false;
+  }
+
+  char magic[sizeof(_input_recording_magic)];
+  uint32_t binding_count;
+  if(fread(magic, sizeof(magic), 1, file) != 1 || fread(&binding_count, sizeof(binding_count), 1, file) != 1
+  || memcmp(magic, _input_recording_magic, sizeof(magic)) != 0) {
+    ALIAS_ERROR("%s is not an input recording", path);
+    fclose(file);
+    return false;
+  }
+  if(binding_count != _input_binding_count) {
+    ALIAS_ERROR("input recording %s has %u bindings, the game has %u", path, binding_count, _input_binding_count);
+    fclose(file);
+    return false;
+  }
+
+  _input_replay.file = file;
+  _input_replay.time = alias_R_ZERO;
+  alias_memory_clear(_input_bindings, sizeof(*_input_bindings) * _input_binding_count);
+
+  return true;
+}
+
+void Engine_stop_input_replay(void) {
+  if(_input_replay.file == NULL) {
+    return;
+  }
+  fclose(_input_replay.file);
+  _input_replay.file = NULL;
+}
+
+bool Engine_replaying_input(void) {
+  return _input_replay.file != NULL;
+}
+
+static void _input_record_frame(void) {
+  uint16_t num_changed = 0;
+  for(uint32_t i = 0; i < _input_binding_count; i++) {
+    num_changed += _input_bindings[i] != _input_record.previous[i];
+  }
+
+  float frame_time = _frame_time;
+  fwrite(&frame_time, sizeof(frame_time), 1, _input_record.file);
+  fwrite(&num_changed, sizeof(num_changed), 1, _input_record.file);
+
+  for(uint32_t i = 0; i < _input_binding_count; i++) {
+    if(_input_bindings[i] != _input_record.previous[i]) {
+      uint16_t binding = i;
+      float value = _input_bindings[i];
+      fwrite(&binding, sizeof(binding), 1, _input_record.file);
+      fwrite(&value, sizeof(value), 1, _input_record.file);
+      _input_record.previous[i] = _input_bindings[i];
+    }
+  }
+}
+
+// called at the start of a frame, before anything reads the frame time. false once the recording ran out
+static bool _input_replay_frame(void) {
+  float frame_time;
+  uint16_t num_changed;
+  if(fread(&frame_time, sizeof(frame_time), 1, _input_replay.file) != 1
+  || fread(&num_changed, sizeof(num_changed), 1, _input_replay.file) != 1) {
+    Engine_stop_input_replay();
+    return false;
+  }
+
+  for(uint16_t i = 0; i < num_changed; i++) {
+    uint16_t binding;
+    float value;
+    if(fread(&binding, sizeof(binding), 1, _input_replay.file) != 1 || fread(&value, sizeof(value), 1, _input_replay.file) != 1) {
+      Engine_stop_input_replay();
+      return false;
+    }
+    if(binding < _input_binding_count) {
+      _input_bindings[binding] = value;
+    }
+  }
+
+  _frame_time = frame_time;
+  _input_replay.time += _frame_time;
+  return true;
+}
+
+// the game runs on the float that is written, so the replay sees the same bits
+static void _input_record_step(void) {
+  if(_input_record.file != NULL) {
+    _frame_time = (float)_frame_time;
+    _input_record.time += _frame_time;
+  }
+}
+
+static void _input_read_backend(void) {
   alias_memory_clear(_input_bindings, sizeof(*_input_bindings) * _input_binding_count);
 
   for(uint32_t i = 0; i < _input_backend_pair_count; i++) {
@@ -251,6 +770,19 @@ static void _update_input(void) {
       break;
     }
   }
+}
+
+static void _update_input(void) {
+  TRACE_ZONE("input");
+
+  // a replay already put this frame's bindings in place
+  if(_input_replay.file == NULL) {
+    _input_read_backend();
+  }
+
+  if(_input_record.file != NULL) {
+    _input_record_frame();
+  }
 
   for(uint32_t i = 0; i < MAX_INPUT_FRONTEND_SETS; i++) {
     for(uint32_t j = 0; j < _input_frontends[i].count; j++) {
@@ -290,8 +822,8 @@ static void _update_input(void) {
           alias_R px = _input_bindings[signal->bindings[0]];
           alias_R py = _input_bindings[signal->bindings[1]];
 
-          const struct Camera * camera = Camera_read(signal->click_camera);
-          const struct alias_LocalToWorld2D * transform = alias_LocalToWorld2D_read(signal->click_camera);
+          const struct Camera * camera = Camera_read_cached(&signal->click_camera_cache, signal->click_camera);
+          const struct alias_LocalToWorld2D * transform = alias_LocalToWorld2D_read_cached(&signal->click_camera_transform_cache, signal->click_camera);
 
           alias_R minx = alias_pga2d_point_x(camera->viewport_min) * _screen_width;
           alias_R miny = alias_pga2d_point_y(camera->viewport_min) * _screen_height;
@@ -324,59 +856,11 @@ static void _update_input(void) {
   }
 }
 
-// events
-DEFINE_COMPONENT(Event)
-
-static uint32_t _events_id = 1;
-
-uint32_t Engine_next_event_id(void) {
-  return _events_id++;
-}
-
-QUERY( _update_events
-  , state(uint32_t, last_highest_seen)
-  , state(struct CmdBuf, cbuf)
-  , state(uint32_t, next_highest_seen)
-  , pre(
-    CmdBuf_begin_recording(&state->cbuf);
-    state->next_highest_seen = state->last_highest_seen;
-  )
-  , read(Event, e)
-  , action(
-    if(e->id <= state->last_highest_seen) {
-      CmdBuf_despawn(&state->cbuf, entity);
-    } else if(e->id > state->next_highest_seen) {
-      state->next_highest_seen = e->id;
-    }
-  )
-  , post(
-    state->last_highest_seen = state->next_highest_seen;
-    CmdBuf_end_recording(&state->cbuf);
-    CmdBuf_execute(&state->cbuf, Engine_ecs());
-  )
-)
-
 // transform
-alias_TransformBundle * Engine_transform_bundle(void) {
-  static alias_TransformBundle bundle;
-  static bool init = false;
-  if(!init) {
-    alias_TransformBundle_initialize(Engine_ecs(), &bundle);
-    init = true;
-  }
-  return &bundle;
-}
+alias_TransformBundle _engine_transform_bundle;
 
 // physics
-alias_Physics2DBundle * Engine_physics_2d_bundle(void) {
-  static alias_Physics2DBundle bundle;
-  static bool init = false;
-  if(!init) {
-    alias_Physics2DBundle_initialize(Engine_ecs(), &bundle, Engine_transform_bundle());
-    init = true;
-  }
-  return &bundle;
-}
+alias_Physics2DBundle _engine_physics_2d_bundle;
 
 alias_R Engine_physics_speed(void) {
   return _physics_speed;
@@ -386,27 +870,71 @@ void Engine_set_physics_speed(alias_R speed) {
   _physics_speed = speed;
 }
 
+uint32_t Engine_physics_max_substeps(void) {
+  return _physics_max_substeps;
+}
+
+void Engine_set_physics_max_substeps(uint32_t max_substeps) {
+  _physics_max_substeps = max_substeps;
+}
+
+alias_R Engine_physics_interpolation(void) {
+  return _physics_interpolation;
+}
+
 alias_R Engine_frame_time(void) {
-  return Backend_get_frame_time();
+  return _frame_time;
 }
 
 alias_R Engine_time(void) {
+  if(_input_replay.file != NULL) {
+    return _input_replay.time;
+  }
+  if(_input_record.file != NULL) {
+    return _input_record.time;
+  }
   return Backend_get_time();
 }
 
+DEFINE_COMPONENT(PreviousLocalToWorld2D)
+
+QUERY_CHUNK(_physics_store_previous
+  , read(alias_LocalToWorld2D, t)
+  , write(PreviousLocalToWorld2D, p)
+  , action(
+    for(uint32_t i = 0; i < count; i++) {
+      p[i].motor = t[i].motor;
+      p[i].position = t[i].position;
+      p[i].valid = true;
+    }
+  )
+)
+
 static void _update_physics(void) {
-  const float timestep = 1.0f / 60.0f;
+  TRACE_ZONE("physics");
+
+  const float timestep = PHYSICS_TIMESTEP;
 
   static float p_time = 0.0f;
   static float s_time = 0.0f;
 
-  s_time += Backend_get_frame_time() * _physics_speed;
+  s_time += Engine_frame_time() * _physics_speed;
+
+  // after a hitch only run up to the max substeps, the time beyond that is dropped
+  if(_physics_max_substeps > 0 && s_time - p_time > timestep * _physics_max_substeps) {
+    s_time = p_time + timestep * _physics_max_substeps;
+  }
 
   if(p_time >= s_time) {
     alias_transform_update2d_serial(Engine_ecs(), Engine_transform_bundle());
   }
 
   while(p_time < s_time) {
+    // the transforms before the last step of the frame are what rendering interpolates from
+    if(p_time + timestep >= s_time) {
+      _physics_store_previous();
+    }
+
     alias_physics_update2d_serial_pre_transform(Engine_ecs(), Engine_physics_2d_bundle(), timestep);
 
     alias_transform_update2d_serial(Engine_ecs(), Engine_transform_bundle());
@@ -415,6 +943,58 @@ static void _update_physics(void) {
 
     p_time += timestep;
   }
+
+  // p_time is the current step, p_time - timestep the previous one
+  _physics_interpolation = alias_R_ONE - (p_time - s_time) / timestep;
+}
+
+static inline alias_pga2d_Point _interpolate_point(alias_pga2d_Point a, alias_pga2d_Point b, alias_R t) {
+  alias_R ax = alias_pga2d_point_x(a), ay = alias_pga2d_point_y(a);
+  return alias_pga2d_point(ax + (alias_pga2d_point_x(b) - ax) * t, ay + (alias_pga2d_point_y(b) - ay) * t);
+}
+
+// normalized lerp of the rotor and translation parts, a is flipped onto b's side first so rotations take the short
+// way round. exact at both ends
+static inline alias_pga2d_Motor _interpolate_motor(alias_pga2d_Motor a, alias_pga2d_Motor b, alias_R t) {
+  if(a.one * b.one + a.e12 * b.e12 < alias_R_ZERO) {
+    a.one = -a.one;
+    a.e12 = -a.e12;
+    a.e01 = -a.e01;
+    a.e02 = -a.e02;
+  }
+  alias_pga2d_Motor m = b;
+  m.one = a.one + (b.one - a.one) * t;
+  m.e12 = a.e12 + (b.e12 - a.e12) * t;
+  m.e01 = a.e01 + (b.e01 - a.e01) * t;
+  m.e02 = a.e02 + (b.e02 - a.e02) * t;
+  alias_R norm = alias_R_sqrt(m.one * m.one + m.e12 * m.e12);
+  m.one /= norm;
+  m.e12 /= norm;
+  m.e01 /= norm;
+  m.e02 /= norm;
+  return m;
+}
+
+static inline bool _interpolating(const struct PreviousLocalToWorld2D * previous) {
+  return previous != NULL && previous->valid && _physics_interpolation < alias_R_ONE;
+}
+
+static inline alias_pga2d_Point _interpolated_position(const struct alias_LocalToWorld2D * t, const struct PreviousLocalToWorld2D * previous) {
+  if(_interpolating(previous)) {
+    return _interpolate_point(previous->position, t->position, _physics_interpolation);
+  }
+  return t->position;
+}
+
+// moves local box corners into the world, between the last two physics steps when the entity is interpolated
+static inline void _interpolated_box(alias_pga2d_Point box[4], const struct alias_LocalToWorld2D * t, const struct PreviousLocalToWorld2D * previous) {
+  for(uint32_t i = 0; i < 4; i++) {
+    alias_pga2d_Point corner = box[i];
+    box[i] = alias_pga2d_sandwich_bm(corner, t->motor);
+    if(_interpolating(previous)) {
+      box[i] = _interpolate_point(alias_pga2d_sandwich_bm(corner, previous->motor), box[i], _physics_interpolation);
+    }
+  }
 }
 
 // ====================================================================================================================
@@ -442,10 +1022,12 @@ alias_Vector(struct LoadedResource *) _resources = ALIAS_VECTOR_INIT;
 
 static uint32_t _resource_id = 1, _resource_gen = 1;
 
+static void _render_release_image(const struct BackendImage * image);
+
 void _free_resource(struct LoadedResource * resource) {
   switch(resource->type) {
   case ResourceType_Image:
-    BackendImage_unload(&resource->image);
+    _render_release_image(&resource->image);
     break;
   }
 
@@ -512,6 +1094,232 @@ struct LoadedResource * _load_image(struct Image * img) {
   return img->resource;
 }
 
+// ====================================================================================================================
+// Render Frame =======================================================================================================
+// everything drawn in a frame is recorded into a RenderFrame and replayed into the backend afterwards. with pipelined
+// rendering the replay happens on the render thread, which reads the frame recorded last while the simulation records
+// the next one into the other half of the double buffer. draws copy their image when recorded, the loop thread keeps
+// writing the resource as uploads finish, and an image given up while recording is only unloaded once the frame that
+// recorded it has been replayed
+enum RenderCommandType {
+    RenderCommandType_Begin2D
+  , RenderCommandType_End2D
+  , RenderCommandType_Draw
+};
+
+struct RenderCommand {
+  enum RenderCommandType type;
+  union {
+    struct BackendMode2D mode;
+    struct {
+      bool textured;
+      struct BackendImage image;
+      uint32_t first_vertex;
+      uint32_t first_index;
+      uint32_t num_indexes;
+    } draw;
+  };
+};
+
+struct RenderFrame {
+  uint32_t screen_width;
+  uint32_t screen_height;
+  alias_Vector(struct RenderCommand) commands;
+  alias_Vector(struct BackendUIVertex) vertexes;
+  alias_Vector(uint32_t) indexes;
+  alias_Vector(struct BackendImage) unloads;
+};
+
+static struct RenderFrame _render_frames[2];
+static uint32_t _render_frame_index = 0;
+
+static bool _render_pipelined = false;
+static bool _render_thread_running = false;
+static bool _render_thread_quit;
+static uv_thread_t _render_thread;
+static uv_sem_t _render_thread_ready;
+static uv_sem_t _render_thread_done;
+
+static inline struct RenderFrame * _render_frame(void) {
+  return &_render_frames[_render_frame_index];
+}
+
+static void _render_release_image(const struct BackendImage * image) {
+  struct RenderFrame * frame = _render_frame();
+  alias_Vector_space_for(&frame->unloads, alias_default_MemoryCB(), 1);
+  *alias_Vector_push(&frame->unloads) = *image;
+}
+
+static void _render_unload_images(struct RenderFrame * frame) {
+  for(uint32_t i = 0; i < frame->unloads.length; i++) {
+    BackendImage_unload(&frame->unloads.data[i]);
+  }
+  frame->unloads.length = 0;
+}
+
+static void _render_begin_frame(void) {
+  struct RenderFrame * frame = _render_frame();
+  frame->screen_width = _screen_width;
+  frame->screen_height = _screen_height;
+  frame->commands.length = 0;
+  frame->vertexes.length = 0;
+  frame->indexes.length = 0;
+}
+
+static inline struct RenderCommand * _render_push_command(enum RenderCommandType type) {
+  struct RenderFrame * frame = _render_frame();
+  alias_Vector_space_for(&frame->commands, alias_default_MemoryCB(), 1);
+  struct RenderCommand * command = alias_Vector_push(&frame->commands);
+  command->type = type;
+  return command;
+}
+
+static void _render_begin_2d(struct BackendMode2D mode) {
+  _render_push_command(RenderCommandType_Begin2D)->mode = mode;
+}
+
+static void _render_end_2d(void) {
+  _render_push_command(RenderCommandType_End2D);
+}
+
+// room for num_vertexes at the end of the frame, filled in by the caller
+static struct BackendUIVertex * _render_reserve_vertexes(uint32_t num_vertexes, uint32_t * first_vertex) {
+  struct RenderFrame * frame = _render_frame();
+  *first_vertex = frame->vertexes.length;
+  alias_Vector_space_for(&frame->vertexes, alias_default_MemoryCB(), num_vertexes);
+  frame->vertexes.length += num_vertexes;
+  return frame->vertexes.data + *first_vertex;
+}
+
+static uint32_t _render_push_vertexes(uint32_t num_vertexes, const struct BackendUIVertex * vertexes) {
+  uint32_t first_vertex;
+  size_t size = sizeof(*vertexes) * num_vertexes;
+  alias_memory_copy(_render_reserve_vertexes(num_vertexes, &first_vertex), size, vertexes, size);
+  return first_vertex;
+}
+
+static void _render_push_draw(const struct BackendImage * image, uint32_t first_vertex, uint32_t num_indexes, const uint32_t * indexes) {
+  if(num_indexes == 0) {
+    return;
+  }
+
+  struct RenderFrame * frame = _render_frame();
+  uint32_t first_index = frame->indexes.length;
+  size_t size = sizeof(*indexes) * num_indexes;
+  alias_Vector_space_for(&frame->indexes, alias_default_MemoryCB(), num_indexes);
+  alias_memory_copy(frame->indexes.data + first_index, size, indexes, size);
+  frame->indexes.length += num_indexes;
+
+  struct RenderCommand * command = _render_push_command(RenderCommandType_Draw);
+  command->draw.textured = image != NULL;
+  if(image != NULL) {
+    command->draw.image = *image;
+  }
+  command->draw.first_vertex = first_vertex;
+  command->draw.first_index = first_index;
+  command->draw.num_indexes = num_indexes;
+}
+
+static void _render_draw(const struct BackendImage * image, uint32_t num_vertexes, const struct BackendUIVertex * vertexes, uint32_t num_indexes, const uint32_t * indexes) {
+  _render_push_draw(image, _render_push_vertexes(num_vertexes, vertexes), num_indexes, indexes);
+}
+
+static void _render_replay(struct RenderFrame * frame) {
+  TRACE_ZONE("render");
+
+  Backend_begin_rendering(frame->screen_width, frame->screen_height);
+
+  for(uint32_t i = 0; i < frame->commands.length; i++) {
+    const struct RenderCommand * command = &frame->commands.data[i];
+    switch(command->type) {
+    case RenderCommandType_Begin2D:
+      Backend_begin_2d(command->mode);
+      break;
+    case RenderCommandType_End2D:
+      Backend_end_2d();
+      break;
+    case RenderCommandType_Draw:
+      BackendUIVertex_render(
+          command->draw.textured ? &command->draw.image : NULL
+        , frame->vertexes.data + command->draw.first_vertex
+        , command->draw.num_indexes
+        , frame->indexes.data + command->draw.first_index
+        );
+      break;
+    }
+  }
+
+  Backend_end_rendering();
+}
+
+static void _render_thread_f(void * arg) {
+  (void)arg;
+
+  Engine_trace_thread_name("render");
+
+  for(;;) {
+    uv_sem_wait(&_render_thread_ready);
+    if(_render_thread_quit) {
+      break;
+    }
+    _render_replay(&_render_frames[_render_frame_index ^ 1]);
+    uv_sem_post(&_render_thread_done);
+  }
+}
+
+static void _render_thread_start(void) {
+  _render_thread_quit = false;
+  uv_sem_init(&_render_thread_ready, 0);
+  uv_sem_init(&_render_thread_done, 1);
+  uv_thread_create(&_render_thread, _render_thread_f, NULL);
+  _render_thread_running = true;
+}
+
+// nothing is in flight afterwards, so every image given up so far can go
+static void _render_thread_stop(void) {
+  if(_render_thread_running) {
+    uv_sem_wait(&_render_thread_done);
+    _render_thread_quit = true;
+    uv_sem_post(&_render_thread_ready);
+    uv_thread_join(&_render_thread);
+    uv_sem_destroy(&_render_thread_ready);
+    uv_sem_destroy(&_render_thread_done);
+    _render_thread_running = false;
+  }
+  _render_unload_images(&_render_frames[0]);
+  _render_unload_images(&_render_frames[1]);
+}
+
+// the sync point between simulation and rendering, the recorded frame is handed off and recording switches buffers
+static void _render_submit(void) {
+  if(_render_pipelined && !_render_thread_running) {
+    _render_thread_start();
+  } else if(!_render_pipelined && _render_thread_running) {
+    _render_thread_stop();
+  }
+
+  if(!_render_thread_running) {
+    _render_replay(_render_frame());
+    _render_unload_images(&_render_frames[0]);
+    _render_unload_images(&_render_frames[1]);
+    return;
+  }
+
+  // the other frame is done with its images
+  uv_sem_wait(&_render_thread_done);
+  _render_unload_images(&_render_frames[_render_frame_index ^ 1]);
+  _render_frame_index ^= 1;
+  uv_sem_post(&_render_thread_ready);
+}
+
+bool Engine_pipelined_rendering(void) {
+  return _render_pipelined;
+}
+
+void Engine_set_pipelined_rendering(bool enabled) {
+  _render_pipelined = enabled;
+}
+
 // ====================================================================================================================
 // Font ===============================================================================================================
 enum FontAtlasType {
@@ -558,10 +1366,13 @@ const struct FontGlyph * Font_find_glyph(const struct Font * font, const char *
 }
 
 void Font_draw(struct Font * font, const char * text, float x, float y, float size, float spacing, alias_Color color) {
-  #define FONT_DRAW_CHARACTERS_PER_BATCH 128
+  uint32_t length = strlen(text);
+  if(length == 0) {
+    return;
+  }
 
-  struct BackendUIVertex vertexes[4 * FONT_DRAW_CHARACTERS_PER_BATCH];
-  uint32_t indexes[6 * FONT_DRAW_CHARACTERS_PER_BATCH];
+  struct BackendUIVertex * vertexes = Engine_frame_alloc(sizeof(*vertexes) * 4 * length, alignof(*vertexes));
+  uint32_t * indexes = Engine_frame_alloc(sizeof(*indexes) * 6 * length, alignof(*indexes));
   uint32_t i = 0;
 
   struct BackendImage * image = &_load_image(&font->atlas)->image;
@@ -598,14 +1409,9 @@ void Font_draw(struct Font * font, const char * text, float x, float y, float si
 
     x += glyph->advance * size + spacing;
     i++;
-
-    if(i >= FONT_DRAW_CHARACTERS_PER_BATCH) {
-      BackendUIVertex_render(image, vertexes, 6 * FONT_DRAW_CHARACTERS_PER_BATCH, indexes);
-      i = 0;
-    }
   }
 
-  BackendUIVertex_render(image, vertexes, 6 * i, indexes);
+  _render_draw(image, 4 * i, vertexes, 6 * i, indexes);
 }
 
 void Font_measure(struct Font * font, const char * text, float size, float spacing, float * width, float * height) {
@@ -630,47 +1436,59 @@ DEFINE_COMPONENT(DrawRectangle)
 
 DEFINE_COMPONENT(DrawCircle)
 
+static void _draw_text_pointers(void * data, intptr_t slide) {
+  struct DrawText * text = (struct DrawText *)data;
+  text->text = Snapshot_slide(text->text, slide);
+}
+
 DEFINE_COMPONENT(DrawText)
+COMPONENT_SNAPSHOT(DrawText, NULL, _draw_text_pointers)
+
+static void _sprite_pointers(void * data, intptr_t slide) {
+  struct Sprite * sprite = (struct Sprite *)data;
+  sprite->image = (struct Image *)Snapshot_slide(sprite->image, slide);
+}
 
 DEFINE_COMPONENT(Sprite)
+COMPONENT_SNAPSHOT(Sprite, NULL, _sprite_pointers)
 
 static void _update_ui(void);
 
+static const uint32_t _quad_indexes[] = { 0, 1, 2, 0, 2, 3 };
+
+static void _rectangle_quad(struct BackendUIVertex vertexes[4], const struct alias_LocalToWorld2D * t, const struct DrawRectangle * r, const struct PreviousLocalToWorld2D * previous) {
+  alias_R
+      hw = r->width / 2
+    , hh = r->height / 2
+    , bl = -hw
+    , br =  hw
+    , bt = -hh
+    , bb =  hh
+    ;
+
+  alias_pga2d_Point box[] = {
+      alias_pga2d_point(br, bb)
+    , alias_pga2d_point(br, bt)
+    , alias_pga2d_point(bl, bt)
+    , alias_pga2d_point(bl, bb)
+    };
+
+  _interpolated_box(box, t, previous);
+
+  for(uint32_t i = 0; i < 4; i++) {
+    vertexes[i] = (struct BackendUIVertex) { .xy = { alias_pga2d_point_x(box[i]), alias_pga2d_point_y(box[i]) }, .rgba = { r->color.r, r->color.g, r->color.b, r->color.a } };
+  }
+}
+
+// rectangles without PreviousLocalToWorld2D are drawn from the vertex cache
 QUERY(_draw_rectangles
   , read(alias_LocalToWorld2D, t)
   , read(DrawRectangle, r)
+  , read(PreviousLocalToWorld2D, previous)
   , action(
-    alias_R
-        hw = r->width / 2
-      , hh = r->height / 2
-      , bl = -hw
-      , br =  hw
-      , bt = -hh
-      , bb =  hh
-      ;
-
-    alias_pga2d_Point box[] = {
-        alias_pga2d_point(br, bb)
-      , alias_pga2d_point(br, bt)
-      , alias_pga2d_point(bl, bt)
-      , alias_pga2d_point(bl, bb)
-      };
-
-    box[0] = alias_pga2d_sandwich_bm(box[0], t->motor);
-    box[1] = alias_pga2d_sandwich_bm(box[1], t->motor);
-    box[2] = alias_pga2d_sandwich_bm(box[2], t->motor);
-    box[3] = alias_pga2d_sandwich_bm(box[3], t->motor);
-
-    struct BackendUIVertex vertexes[] = {
-        { .xy[0] = alias_pga2d_point_x(box[0]), .xy[1] = alias_pga2d_point_y(box[0]), .rgba = { r->color.r, r->color.g, r->color.b, r->color.a } }
-      , { .xy[0] = alias_pga2d_point_x(box[1]), .xy[1] = alias_pga2d_point_y(box[1]), .rgba = { r->color.r, r->color.g, r->color.b, r->color.a } }
-      , { .xy[0] = alias_pga2d_point_x(box[2]), .xy[1] = alias_pga2d_point_y(box[2]), .rgba = { r->color.r, r->color.g, r->color.b, r->color.a } }
-      , { .xy[0] = alias_pga2d_point_x(box[3]), .xy[1] = alias_pga2d_point_y(box[3]), .rgba = { r->color.r, r->color.g, r->color.b, r->color.a } }
-    };
-
-    uint32_t indexes[] = { 0, 1, 2, 0, 2, 3 };
-
-    BackendUIVertex_render(NULL, vertexes, 6, indexes);
+    struct BackendUIVertex vertexes[4];
+    _rectangle_quad(vertexes, t, r, previous);
+    _render_draw(NULL, 4, vertexes, 6, _quad_indexes);
   )
 )
 
@@ -700,7 +1518,7 @@ void replacement_DrawCircle(float x, float y, float radius, alias_Color color) {
     }
   }
 
-  BackendUIVertex_render(NULL, vertexes, 3 * (NUM_CIRCLE_SEGMENTS - 2), indexes);
+  _render_draw(NULL, NUM_CIRCLE_SEGMENTS, vertexes, 3 * (NUM_CIRCLE_SEGMENTS - 2), indexes);
 
 #undef NUM_CIRCLE_SEGMENTS
 }
@@ -821,88 +1639,462 @@ void replacement_MeasureTextEx(const char * text, float size, float spacing, flo
 QUERY(_draw_circles
   , read(alias_LocalToWorld2D, transform)
   , read(DrawCircle, c)
+  , read(PreviousLocalToWorld2D, previous)
+  , optional(PreviousLocalToWorld2D)
   , action(
-    replacement_DrawCircle(alias_pga2d_point_x(transform->position), alias_pga2d_point_y(transform->position), c->radius, c->color);
+    alias_pga2d_Point position = _interpolated_position(transform, previous);
+    replacement_DrawCircle(alias_pga2d_point_x(position), alias_pga2d_point_y(position), c->radius, c->color);
   )
 )
 
 QUERY(_draw_text
   , read(alias_LocalToWorld2D, w)
   , read(DrawText, t)
+  , read(PreviousLocalToWorld2D, previous)
+  , optional(PreviousLocalToWorld2D)
   , action(
-    replacement_DrawText(t->text, alias_pga2d_point_x(w->position), alias_pga2d_point_y(w->position), t->size, t->color);
+    alias_pga2d_Point position = _interpolated_position(w, previous);
+    replacement_DrawText(t->text, alias_pga2d_point_x(position), alias_pga2d_point_y(position), t->size, t->color);
   )
 )
 
+static void _sprite_quad(struct BackendUIVertex vertexes[4], const struct alias_LocalToWorld2D * t, const struct Sprite * s, const struct PreviousLocalToWorld2D * previous, const struct BackendImage * image) {
+  alias_R
+      hw = image->width / 2
+    , hh = image->height / 2
+    , bl = -hw
+    , br =  hw
+    , bt = -hh
+    , bb =  hh
+    ;
+
+  alias_pga2d_Point box[] = {
+      alias_pga2d_point(br, bb)
+    , alias_pga2d_point(br, bt)
+    , alias_pga2d_point(bl, bt)
+    , alias_pga2d_point(bl, bb)
+    };
+
+  _interpolated_box(box, t, previous);
+
+  vertexes[0] = (struct BackendUIVertex) { .xy = { alias_pga2d_point_x(box[0]), alias_pga2d_point_y(box[0]) }, .rgba = { s->color.r, s->color.g, s->color.b, s->color.a }, .st = { s->s1, s->t1 } };
+  vertexes[1] = (struct BackendUIVertex) { .xy = { alias_pga2d_point_x(box[1]), alias_pga2d_point_y(box[1]) }, .rgba = { s->color.r, s->color.g, s->color.b, s->color.a }, .st = { s->s1, s->t0 } };
+  vertexes[2] = (struct BackendUIVertex) { .xy = { alias_pga2d_point_x(box[2]), alias_pga2d_point_y(box[2]) }, .rgba = { s->color.r, s->color.g, s->color.b, s->color.a }, .st = { s->s0, s->t0 } };
+  vertexes[3] = (struct BackendUIVertex) { .xy = { alias_pga2d_point_x(box[3]), alias_pga2d_point_y(box[3]) }, .rgba = { s->color.r, s->color.g, s->color.b, s->color.a }, .st = { s->s0, s->t1 } };
+}
+
+// sprites without PreviousLocalToWorld2D are drawn from the vertex cache
 QUERY(_draw_sprites
   , read(alias_LocalToWorld2D, t)
   , read(Sprite, s)
+  , read(PreviousLocalToWorld2D, previous)
   , action(
     struct LoadedResource * res = _load_image(s->image);
+    struct BackendUIVertex vertexes[4];
+    _sprite_quad(vertexes, t, s, previous, &res->image);
+    _render_draw(&res->image, 4, vertexes, 6, _quad_indexes);
+  )
+)
 
-    alias_R
-        hw = res->image.width / 2
-      , hh = res->image.height / 2
-      , bl = -hw
-      , br =  hw
-      , bt = -hh
-      , bb =  hh
-      ;
-
-    alias_pga2d_Point box[] = {
-        alias_pga2d_point(br, bb)
-      , alias_pga2d_point(br, bt)
-      , alias_pga2d_point(bl, bt)
-      , alias_pga2d_point(bl, bb)
-      };
-
-    box[0] = alias_pga2d_sandwich_bm(box[0], t->motor);
-    box[1] = alias_pga2d_sandwich_bm(box[1], t->motor);
-    box[2] = alias_pga2d_sandwich_bm(box[2], t->motor);
-    box[3] = alias_pga2d_sandwich_bm(box[3], t->motor);
-
-    struct BackendUIVertex vertexes[] = {
-        { .xy = { alias_pga2d_point_x(box[0]), alias_pga2d_point_y(box[0]) }, .rgba = { s->color.r, s->color.g, s->color.b, s->color.a }, .st = { s->s1, s->t1 } }
-      , { .xy = { alias_pga2d_point_x(box[1]), alias_pga2d_point_y(box[1]) }, .rgba = { s->color.r, s->color.g, s->color.b, s->color.a }, .st = { s->s1, s->t0 } }
-      , { .xy = { alias_pga2d_point_x(box[2]), alias_pga2d_point_y(box[2]) }, .rgba = { s->color.r, s->color.g, s->color.b, s->color.a }, .st = { s->s0, s->t0 } }
-      , { .xy = { alias_pga2d_point_x(box[3]), alias_pga2d_point_y(box[3]) }, .rgba = { s->color.r, s->color.g, s->color.b, s->color.a }, .st = { s->s0, s->t1 } }
-    };
+// ====================================================================================================================
+// Vertex Cache =======================================================================================================
+// sprites and rectangles that are not interpolated keep their world space quad between frames in a slot of a vertex
+// cache. a slot is rebuilt when the draw component was written since the last frame or when alias_LocalToWorld2D no
+// longer matches the transform the quad was built from. the transform update writes every alias_LocalToWorld2D, so
+// modified() alone would rebuild everything. a static scene draws with one copy of the live vertexes per frame,
+// shared by every camera, and one draw per image. slots are tracked by a component that is added the first frame an
+// entity is drawn, and that frees its slot on despawn.
+//
+// cached quads are drawn grouped by image, in slot order within an image, before the sprites that interpolate. there is
+// no depth, so where quads of different images overlap the one on top can differ from ecs order. order that has to
+// hold goes through the image, or through PreviousLocalToWorld2D to keep the entity out of the cache.
+#define VERTEX_CACHE_NO_SLOT UINT32_MAX
+
+struct VertexCacheSlot {
+  struct Image * image;
+  uint32_t width;
+  uint32_t height;
+  bool live;
+  struct alias_LocalToWorld2D transform; // the quad was built from
+};
 
-    uint32_t indexes[6] = {
-        0, 1, 2
-      , 0, 2, 3
-    };
+struct VertexCacheBatch {
+  struct Image * image;
+  uint32_t first_index;
+  uint32_t num_indexes;
+  uint32_t width;
+  uint32_t height;
+};
+
+struct VertexCache {
+  alias_Vector(struct VertexCacheSlot) slots;
+  alias_Vector(struct BackendUIVertex) vertexes; // 4 per slot
+  alias_Vector(uint32_t) free_slots;
+
+  // live slots grouped by image, rebuilt when slots come, go or change image. indexes are into the live quads as
+  // they are copied out in order, dead slots are never drawn
+  bool dirty;
+  alias_Vector(uint32_t) order;
+  alias_Vector(uint32_t) indexes;
+  alias_Vector(struct VertexCacheBatch) batches;
+
+  // the live quads go into the frame once, the first camera that draws them
+  bool pushed;
+  uint32_t first_vertex;
 
-    BackendUIVertex_render(&res->image, vertexes, 6, indexes);
+  // an image finished loading with a new size, every quad of the cache is rebuilt next frame
+  bool rebuild;
+};
+
+static struct VertexCache _sprite_cache, _rectangle_cache;
+
+// structural changes wait until no query is running
+static struct CmdBuf _vertex_cache_cmds;
+
+static uint32_t _vertex_cache_allocate(struct VertexCache * cache) {
+  uint32_t slot;
+  if(cache->free_slots.length > 0) {
+    slot = *alias_Vector_pop(&cache->free_slots);
+  } else {
+    slot = cache->slots.length;
+    alias_Vector_space_for(&cache->slots, alias_default_MemoryCB(), 1);
+    alias_Vector_space_for(&cache->vertexes, alias_default_MemoryCB(), 4);
+    alias_Vector_push(&cache->slots);
+    cache->vertexes.length += 4;
+  }
+  cache->slots.data[slot] = (struct VertexCacheSlot) { .live = true };
+  cache->dirty = true;
+  return slot;
+}
+
+static void _vertex_cache_free(struct VertexCache * cache, uint32_t slot) {
+  if(slot == VERTEX_CACHE_NO_SLOT) {
+    return;
+  }
+  cache->slots.data[slot].live = false;
+  alias_Vector_space_for(&cache->free_slots, alias_default_MemoryCB(), 1);
+  *alias_Vector_push(&cache->free_slots) = slot;
+  cache->dirty = true;
+}
+
+static void _vertex_cache_set(struct VertexCache * cache, uint32_t slot, const struct alias_LocalToWorld2D * t, struct Image * image, uint32_t width, uint32_t height, const struct BackendUIVertex vertexes[4]) {
+  struct VertexCacheSlot * s = &cache->slots.data[slot];
+  s->transform = *t;
+  if(s->image != image || s->width != width || s->height != height) {
+    s->image = image;
+    s->width = width;
+    s->height = height;
+    cache->dirty = true;
+  }
+  alias_memory_copy(cache->vertexes.data + slot * 4, sizeof(*vertexes) * 4, vertexes, sizeof(*vertexes) * 4);
+}
+
+// false while the slot still holds the quad for this transform
+static bool _vertex_cache_moved(const struct VertexCache * cache, uint32_t slot, const struct alias_LocalToWorld2D * t) {
+  return memcmp(&cache->slots.data[slot].transform, t, sizeof(*t)) != 0;
+}
+
+static const struct VertexCache * _vertex_cache_sorting;
+
+// slot breaks ties so the order within an image does not depend on qsort
+static int _vertex_cache_compare(const void * ap, const void * bp) {
+  uint32_t as = *(const uint32_t *)ap, bs = *(const uint32_t *)bp;
+  const struct VertexCacheSlot * a = &_vertex_cache_sorting->slots.data[as];
+  const struct VertexCacheSlot * b = &_vertex_cache_sorting->slots.data[bs];
+  if(a->image != b->image) {
+    return a->image < b->image ? -1 : 1;
+  }
+  return as < bs ? -1 : as > bs;
+}
+
+static void _vertex_cache_batch(struct VertexCache * cache) {
+  cache->order.length = 0;
+  alias_Vector_space_for(&cache->order, alias_default_MemoryCB(), cache->slots.length);
+  for(uint32_t slot = 0; slot < cache->slots.length; slot++) {
+    if(cache->slots.data[slot].live) {
+      *alias_Vector_push(&cache->order) = slot;
+    }
+  }
+  _vertex_cache_sorting = cache;
+  qsort(cache->order.data, cache->order.length, sizeof(*cache->order.data), _vertex_cache_compare);
+
+  cache->indexes.length = 0;
+  cache->batches.length = 0;
+  alias_Vector_space_for(&cache->indexes, alias_default_MemoryCB(), cache->order.length * 6);
+  for(uint32_t i = 0; i < cache->order.length; i++) {
+    const struct VertexCacheSlot * slot = &cache->slots.data[cache->order.data[i]];
+    struct VertexCacheBatch * batch = cache->batches.length > 0 ? &cache->batches.data[cache->batches.length - 1] : NULL;
+    if(batch == NULL || batch->image != slot->image) {
+      alias_Vector_space_for(&cache->batches, alias_default_MemoryCB(), 1);
+      batch = alias_Vector_push(&cache->batches);
+      *batch = (struct VertexCacheBatch) { .image = slot->image, .first_index = cache->indexes.length, .width = slot->width, .height = slot->height };
+    } else if(batch->width != slot->width || batch->height != slot->height) {
+      // quads built at different image sizes, forces a rebuild when drawn
+      batch->width = batch->height = UINT32_MAX;
+    }
+    for(uint32_t j = 0; j < 6; j++) {
+      *alias_Vector_push(&cache->indexes) = i * 4 + _quad_indexes[j];
+    }
+    batch->num_indexes += 6;
+  }
+
+  cache->dirty = false;
+}
+
+static void _vertex_cache_draw(struct VertexCache * cache) {
+  if(cache->dirty) {
+    _vertex_cache_batch(cache);
+  }
+  if(cache->batches.length == 0) {
+    return;
+  }
+
+  if(!cache->pushed) {
+    struct BackendUIVertex * vertexes = _render_reserve_vertexes(cache->order.length * 4, &cache->first_vertex);
+    for(uint32_t i = 0; i < cache->order.length; i++) {
+      alias_memory_copy(vertexes + i * 4, sizeof(*vertexes) * 4, cache->vertexes.data + cache->order.data[i] * 4, sizeof(*vertexes) * 4);
+    }
+    cache->pushed = true;
+  }
+
+  uint32_t first_vertex = cache->first_vertex;
+  for(uint32_t i = 0; i < cache->batches.length; i++) {
+    const struct VertexCacheBatch * batch = &cache->batches.data[i];
+    const struct BackendImage * image = NULL;
+    if(batch->image != NULL) {
+      image = &_load_image(batch->image)->image;
+      cache->rebuild |= image->width != batch->width || image->height != batch->height;
+    }
+    _render_push_draw(image, first_vertex, batch->num_indexes, cache->indexes.data + batch->first_index);
+  }
+}
+
+static void _vertex_cache_track(alias_ecs_ComponentHandle component, Entity entity, uint32_t slot) {
+  CmdBuf_add_component(&_vertex_cache_cmds, entity, component, &slot, sizeof(slot));
+}
+
+static void _vertex_cache_untrack(struct VertexCache * cache, alias_ecs_ComponentHandle component, Entity entity, uint32_t * slot) {
+  _vertex_cache_free(cache, *slot);
+  *slot = VERTEX_CACHE_NO_SLOT;
+  CmdBuf_remove_component(&_vertex_cache_cmds, entity, component);
+}
+
+static void _vertex_cache_apply(void) {
+  CmdBuf_end_recording(&_vertex_cache_cmds);
+  CmdBuf_execute(&_vertex_cache_cmds, Engine_ecs());
+  CmdBuf_begin_recording(&_vertex_cache_cmds);
+}
+
+DECLARE_COMPONENT(SpriteVertexes, {
+  uint32_t slot;
+})
+
+DECLARE_COMPONENT(RectangleVertexes, {
+  uint32_t slot;
+})
+
+static void _sprite_vertexes_cleanup(void * ud, alias_ecs_Instance * instance, alias_ecs_EntityHandle entity, void ** data) {
+  _vertex_cache_free(&_sprite_cache, ((struct SpriteVertexes *)data[0])->slot);
+}
+
+static void _rectangle_vertexes_cleanup(void * ud, alias_ecs_Instance * instance, alias_ecs_EntityHandle entity, void ** data) {
+  _vertex_cache_free(&_rectangle_cache, ((struct RectangleVertexes *)data[0])->slot);
+}
+
+DEFINE_COMPONENT(SpriteVertexes, .cleanup = { _sprite_vertexes_cleanup, NULL })
+COMPONENT_TRANSIENT(SpriteVertexes)
+
+DEFINE_COMPONENT(RectangleVertexes, .cleanup = { _rectangle_vertexes_cleanup, NULL })
+COMPONENT_TRANSIENT(RectangleVertexes)
+
+static void _vertex_cache_sprite(uint32_t slot, const struct alias_LocalToWorld2D * t, const struct Sprite * s) {
+  struct LoadedResource * res = _load_image(s->image);
+  struct BackendUIVertex vertexes[4];
+  _sprite_quad(vertexes, t, s, NULL, &res->image);
+  _vertex_cache_set(&_sprite_cache, slot, t, s->image, res->image.width, res->image.height, vertexes);
+}
+
+static void _vertex_cache_rectangle(uint32_t slot, const struct alias_LocalToWorld2D * t, const struct DrawRectangle * r) {
+  struct BackendUIVertex vertexes[4];
+  _rectangle_quad(vertexes, t, r, NULL);
+  _vertex_cache_set(&_rectangle_cache, slot, t, NULL, 0, 0, vertexes);
+}
+
+QUERY(_vertex_cache_sprites_track
+  , read(alias_LocalToWorld2D, t)
+  , read(Sprite, s)
+  , exclude(SpriteVertexes)
+  , exclude(PreviousLocalToWorld2D)
+  , action(
+    uint32_t slot = _vertex_cache_allocate(&_sprite_cache);
+    _vertex_cache_sprite(slot, t, s);
+    _vertex_cache_track(SpriteVertexes_component(), entity, slot);
+  )
+)
+
+QUERY(_vertex_cache_sprites_moved
+  , read(alias_LocalToWorld2D, t)
+  , read(Sprite, s)
+  , read(SpriteVertexes, v)
+  , modified(alias_LocalToWorld2D)
+  , action(
+    if(_vertex_cache_moved(&_sprite_cache, v->slot, t)) {
+      _vertex_cache_sprite(v->slot, t, s);
+    }
+  )
+)
+
+QUERY(_vertex_cache_sprites_changed
+  , read(alias_LocalToWorld2D, t)
+  , read(Sprite, s)
+  , read(SpriteVertexes, v)
+  , modified(Sprite)
+  , action(
+    _vertex_cache_sprite(v->slot, t, s);
+  )
+)
+
+QUERY(_vertex_cache_sprites_rebuild
+  , read(alias_LocalToWorld2D, t)
+  , read(Sprite, s)
+  , read(SpriteVertexes, v)
+  , action(
+    _vertex_cache_sprite(v->slot, t, s);
+  )
+)
+
+// lost the sprite or started interpolating
+QUERY(_vertex_cache_sprites_orphaned
+  , write(SpriteVertexes, v)
+  , exclude(Sprite)
+  , action(
+    _vertex_cache_untrack(&_sprite_cache, SpriteVertexes_component(), entity, &v->slot);
+  )
+)
+
+QUERY(_vertex_cache_sprites_interpolated
+  , write(SpriteVertexes, v)
+  , read(PreviousLocalToWorld2D, previous)
+  , action(
+    _vertex_cache_untrack(&_sprite_cache, SpriteVertexes_component(), entity, &v->slot);
+  )
+)
+
+QUERY(_vertex_cache_rectangles_track
+  , read(alias_LocalToWorld2D, t)
+  , read(DrawRectangle, r)
+  , exclude(RectangleVertexes)
+  , exclude(PreviousLocalToWorld2D)
+  , action(
+    uint32_t slot = _vertex_cache_allocate(&_rectangle_cache);
+    _vertex_cache_rectangle(slot, t, r);
+    _vertex_cache_track(RectangleVertexes_component(), entity, slot);
   )
 )
 
+QUERY(_vertex_cache_rectangles_moved
+  , read(alias_LocalToWorld2D, t)
+  , read(DrawRectangle, r)
+  , read(RectangleVertexes, v)
+  , modified(alias_LocalToWorld2D)
+  , action(
+    if(_vertex_cache_moved(&_rectangle_cache, v->slot, t)) {
+      _vertex_cache_rectangle(v->slot, t, r);
+    }
+  )
+)
+
+QUERY(_vertex_cache_rectangles_changed
+  , read(alias_LocalToWorld2D, t)
+  , read(DrawRectangle, r)
+  , read(RectangleVertexes, v)
+  , modified(DrawRectangle)
+  , action(
+    _vertex_cache_rectangle(v->slot, t, r);
+  )
+)
+
+QUERY(_vertex_cache_rectangles_orphaned
+  , write(RectangleVertexes, v)
+  , exclude(DrawRectangle)
+  , action(
+    _vertex_cache_untrack(&_rectangle_cache, RectangleVertexes_component(), entity, &v->slot);
+  )
+)
+
+QUERY(_vertex_cache_rectangles_interpolated
+  , write(RectangleVertexes, v)
+  , read(PreviousLocalToWorld2D, previous)
+  , action(
+    _vertex_cache_untrack(&_rectangle_cache, RectangleVertexes_component(), entity, &v->slot);
+  )
+)
+
+// once a frame, before any camera draws
+static void _vertex_cache_update(void) {
+  TRACE_ZONE("vertex cache");
+
+  _sprite_cache.pushed = false;
+  _rectangle_cache.pushed = false;
+
+  if(_sprite_cache.rebuild) {
+    _vertex_cache_sprites_rebuild();
+    _sprite_cache.rebuild = false;
+  } else {
+    _vertex_cache_sprites_moved();
+    _vertex_cache_sprites_changed();
+  }
+  _vertex_cache_sprites_orphaned();
+  _vertex_cache_sprites_interpolated();
+  _vertex_cache_sprites_track();
+  _vertex_cache_apply();
+
+  _vertex_cache_rectangles_moved();
+  _vertex_cache_rectangles_changed();
+  _vertex_cache_rectangles_orphaned();
+  _vertex_cache_rectangles_interpolated();
+  _vertex_cache_rectangles_track();
+  _vertex_cache_apply();
+}
+
 QUERY(_update_display
   , read(alias_LocalToWorld2D, transform)
   , read(Camera, camera)
+  , read(PreviousLocalToWorld2D, previous)
+  , optional(PreviousLocalToWorld2D)
   , pre(
-    Backend_begin_rendering(_screen_width, _screen_height);
+    _vertex_cache_update();
+    _render_begin_frame();
   )
   , action(
     struct BackendMode2D mode;
 
     mode.viewport_min = camera->viewport_min;
     mode.viewport_max = camera->viewport_max;
-    mode.camera = transform->motor;
+    mode.camera = _interpolating(previous) ? _interpolate_motor(previous->motor, transform->motor, _physics_interpolation) : transform->motor;
     mode.zoom = camera->zoom;
     mode.background = alias_Color_from_rgb_u8(245, 245, 245);
-    Backend_begin_2d(mode);
+    _render_begin_2d(mode);
 
+    uint64_t t = uv_hrtime();
+    _vertex_cache_draw(&_sprite_cache);
     _draw_sprites();
+    t = _profile_phase(ProfilePhase_DrawSprites, t);
+    _vertex_cache_draw(&_rectangle_cache);
     _draw_rectangles();
+    t = _profile_phase(ProfilePhase_DrawRectangles, t);
     _draw_circles();
+    t = _profile_phase(ProfilePhase_DrawCircles, t);
     _draw_text();
+    _profile_phase(ProfilePhase_DrawText, t);
 
-    Backend_end_2d();
+    _render_end_2d();
   )
   , post(
+    uint64_t t = uv_hrtime();
     _update_ui();
-    Backend_end_rendering();
+    _profile_phase(ProfilePhase_UI, t);
+    _render_submit();
   )
 )
 
@@ -986,6 +2178,8 @@ void Engine_ui_end(void) {
 }
 
 static void _update_ui(void) {
+  TRACE_ZONE("ui");
+
   static alias_ui_Output output;
 
   output.num_groups = 0;
@@ -1003,6 +2197,8 @@ static void _update_ui(void) {
     alias_ui_end_frame(_ui, alias_default_MemoryCB(), &output);
     _ui_recording = false;
 
+    uint32_t first_vertex = _render_push_vertexes(output.num_vertexes, _ui_vertexes_data);
+
     for(uint32_t g = 0; g < output.num_groups; g++) {
       uint32_t length = _ui_groups[g].length;
       if(length == 0) {
@@ -1011,7 +2207,7 @@ static void _update_ui(void) {
 
       struct LoadedResource * material = _loaded_resource_by_id(_ui_groups[g].texture_id);
 
-      BackendUIVertex_render(&material->image, _ui_vertexes_data, _ui_groups[g].length, _ui_indexes_data + _ui_groups[g].index);
+      _render_push_draw(&material->image, first_vertex, _ui_groups[g].length, _ui_indexes_data + _ui_groups[g].index);
     }
   }
 }
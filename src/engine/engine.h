@@ -17,10 +17,66 @@
 // parameters
 #define MAX_INPUT_FRONTEND_SETS 8
 
+// jobs
+// a counter holds the number of unfinished jobs submitted against it, zero initialize before the first submit
+struct JobCounter {
+  _Atomic uint32_t value;
+};
+
+// runs f on a worker, stealing keeps the workers busy. safe to call from any thread, including inside a job
+void Engine_jobs_run(void (*f)(void * ud), void * ud, struct JobCounter * counter);
+
+// runs f on the Engine_uv_loop thread, from the next loop iteration when called from elsewhere
+void Engine_jobs_run_on_loop(void (*f)(void * ud), void * ud, struct JobCounter * counter);
+
+bool Engine_jobs_done(const struct JobCounter * counter);
+
+// true on the Engine_uv_loop thread
+bool Engine_jobs_on_loop(void);
+
+// runs other jobs until the counter reaches zero, a job waiting on its dependencies does not block its worker
+void Engine_jobs_wait(struct JobCounter * counter);
+
+uint32_t Engine_worker_count(void);
+
+// restarts the pool, only from the loop thread while no jobs are queued
+void Engine_set_worker_count(uint32_t count);
+
+// systems
+struct System {
+  const char * name;
+  void (*run)(void);
+  void (*access)(struct SystemAccess * access);
+};
+
+#define DECLARE_SYSTEM(NAME) \
+  void NAME(void);           \
+  void ALIAS_CPP_CAT(NAME, _access)(struct SystemAccess * access);
+
+#define SYSTEM(NAME) { .name = #NAME, .run = NAME, .access = ALIAS_CPP_CAT(NAME, _access) }
+
+struct Schedule;
+
+// runs the systems as if in order. with parallel systems enabled, systems without conflicting component access run
+// concurrently on the workers
+void Engine_run_systems(uint32_t num_systems, const struct System * systems, struct Schedule ** schedule);
+
+// off by default. concurrent systems each call alias_ecs_execute_query on their own thread at the same time, which
+// assumes alias ecs allows that on created queries with no structural change in flight. every query is still
+// created in a serial first run. only turn it on once that holds for the alias ecs in use
+bool Engine_parallel_systems(void);
+void Engine_set_parallel_systems(bool enabled);
+
 // Engine is the only 'singleton'
 struct State {
   struct State * prev;
   void * ud;
+
+  // run before frame
+  uint32_t num_systems;
+  const struct System * systems;
+  struct Schedule * schedule;
+
   void (*begin)(void * ud);
   void (*frame)(void * ud);
   void (*background)(void * ud);
@@ -44,12 +100,114 @@ void Engine_pop_state(void);
 // parameter access
 alias_ecs_Instance * Engine_ecs(void);
 
+// layers own an arena for memory that lives as long as their entities, component init callbacks allocate from it and
+// destroying the layer frees all of it at once after the entities are gone. ALIAS_ECS_INVALID_LAYER allocates for the
+// lifetime of the engine
+alias_ecs_LayerHandle Engine_create_layer(uint32_t max_entities);
+void Engine_destroy_layer(alias_ecs_LayerHandle layer);
+void * Engine_layer_alloc(alias_ecs_LayerHandle layer, size_t size, size_t align);
+
+// scratch memory for the loop thread that is valid until the end of the next frame, nothing is freed by hand
+void * Engine_frame_alloc(size_t size, size_t align);
+
+// snapshots save entities with their components to a file and load them back into a layer with one spawn per set of
+// components. entities is filled with the loaded entities in layer memory. a snapshot is only good for the build
+// that saved it, see COMPONENT_SNAPSHOT
+bool Engine_snapshot_save(const char * path, uint32_t count, const Entity * entities);
+bool Engine_snapshot_load(const char * path, alias_ecs_LayerHandle layer, uint32_t * count, Entity ** entities);
+
 alias_R Engine_physics_speed(void);
 void Engine_set_physics_speed(alias_R speed);
 
+// steps beyond this in one frame are dropped instead of caught up, 0 is unbounded
+uint32_t Engine_physics_max_substeps(void);
+void Engine_set_physics_max_substeps(uint32_t max_substeps);
+
+// where rendering sits between the previous and the current physics step, in [0, 1]
+alias_R Engine_physics_interpolation(void);
+
 alias_R Engine_frame_time(void);
 alias_R Engine_time(void);
 
+// 0 runs frames back to back
+uint32_t Engine_target_fps(void);
+void Engine_set_target_fps(uint32_t fps);
+
+// the last stretch before a frame deadline is busy waited, the timer before it is only good to a millisecond. a wider
+// window hits deadlines more exactly and burns more of a core
+uint64_t Engine_frame_spin_ns(void);
+void Engine_set_frame_spin_ns(uint64_t spin_ns);
+
+// percentile in [0, 1] over the recent frame history, in seconds
+alias_R Engine_frame_time_percentile(alias_R percentile);
+
+// when enabled the backend replays frame N on a render thread while the simulation produces frame N+1
+bool Engine_pipelined_rendering(void);
+void Engine_set_pipelined_rendering(bool enabled);
+
+// trace
+// zones record into per thread rings, written out as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev).
+// names are kept by pointer and must outlive the trace, string literals in practice
+struct TraceZone {
+  const char * name;
+  uint64_t start;
+};
+
+struct TraceZone Engine_trace_begin(const char * name);
+void Engine_trace_end(struct TraceZone * zone);
+
+// for work that starts and ends in different callbacks, matched by name and id
+void Engine_trace_async_begin(const char * name, uint64_t id);
+void Engine_trace_async_end(const char * name, uint64_t id);
+
+void Engine_trace_thread_name(const char * name);
+
+// off until enabled, ALIAS_TOWN_TRACE turns it on in the game
+bool Engine_trace_enabled(void);
+void Engine_set_trace_enabled(bool enabled);
+
+bool Engine_trace_write(const char * path);
+
+// written when Engine_run returns, NULL to not write
+void Engine_set_trace_exit_path(const char * path);
+
+#ifdef ENGINE_TRACE
+#define TRACE_ZONE(NAME) \
+  struct TraceZone ALIAS_CPP_CAT(_trace_zone_, __LINE__) __attribute__((cleanup(Engine_trace_end))) = Engine_trace_begin(NAME)
+#define TRACE_ASYNC_BEGIN(NAME, ID) Engine_trace_async_begin(NAME, ID)
+#define TRACE_ASYNC_END(NAME, ID) Engine_trace_async_end(NAME, ID)
+#else
+#define TRACE_ZONE(NAME)
+#define TRACE_ASYNC_BEGIN(NAME, ID)
+#define TRACE_ASYNC_END(NAME, ID)
+#endif
+
+// profile
+// phases nest as listed, display includes the draw phases and the ui
+enum ProfilePhase {
+    ProfilePhase_Physics
+  , ProfilePhase_Display
+  , ProfilePhase_DrawSprites
+  , ProfilePhase_DrawRectangles
+  , ProfilePhase_DrawCircles
+  , ProfilePhase_DrawText
+  , ProfilePhase_UI
+  , ProfilePhase_Input
+  , ProfilePhase_Events
+  , ProfilePhase_State
+  , ProfilePhase_COUNT
+};
+
+const char * Engine_profile_name(enum ProfilePhase phase);
+
+// per frame, over the recent frame history, in seconds
+alias_R Engine_profile_min(enum ProfilePhase phase);
+alias_R Engine_profile_avg(enum ProfilePhase phase);
+alias_R Engine_profile_p99(enum ProfilePhase phase);
+
+bool Engine_profile_overlay(void);
+void Engine_set_profile_overlay(bool enabled);
+
 // input
 enum InputSource {
   Keyboard_Apostrophe,
@@ -186,7 +344,11 @@ struct InputSignal {
   // inputs
   uint32_t bindings[2];
   union {
-    Entity click_camera;
+    struct {
+      Entity click_camera;
+      struct ComponentCache click_camera_cache;
+      struct ComponentCache click_camera_transform_cache;
+    };
   };
 
   // output
@@ -213,29 +375,98 @@ void Engine_set_player_input_backend(uint32_t player_index, uint32_t pair_count,
 uint32_t Engine_add_input_frontend(uint32_t player_index, uint32_t signal_count, struct InputSignal * signals);
 void Engine_remove_input_frontend(uint32_t player_index, uint32_t index);
 
+// records the input bindings and the frame time of every frame, start after the input backend is set. the game runs
+// at its live speed while recording, a replay runs each frame with the recorded frame time and so takes the same steps
+bool Engine_record_input(const char * path);
+void Engine_stop_input_recording(void);
+
+// replaces the backend input and the frame clock with a recording, the engine exits when it runs out
+bool Engine_replay_input(const char * path);
+void Engine_stop_input_replay(void);
+bool Engine_replaying_input(void);
+
 // event
-DECLARE_COMPONENT(Event, {
-  uint32_t id;
-})
+// every event type has its own ring of payloads, each read site keeps a cursor and walks the events it has not seen
+// yet. publishing records the event into the calling thread's command buffer like any structural change, so systems
+// and parallel query chunks can publish at once. the events go into the ring at the next sync point in system, chunk
+// and recording order, the same order every run. an event can be read from then until the end of the frame after the
+// one it went in, the ring grows rather than drop one that can still be read. rings only change at sync points, so
+// publishing inside a READ_EVENTS over the same channel is fine
+struct EventChannel {
+  struct EventChannel * next;
+  const char * name;
+  uint32_t size;
+  uint32_t capacity; // power of two
+  uint64_t head;     // events ever published
+  uint64_t tail;     // oldest event that can still be read
+  uint64_t frame;    // head when the frame began
+  uint8_t * data;
+};
 
-#define SPAWN_EVENT(...) SPAWN(( Event, .id = event_id() ), ## __VA_ARGS__)
+struct EventReader {
+  uint64_t cursor;
+  uint64_t missed; // events that were gone before the reader got to them
+};
+
+void Engine_add_event_channel(struct EventChannel * channel);
+void EventChannel_grow(struct EventChannel * channel);
+const void * EventChannel_first(const struct EventChannel * channel, struct EventReader * reader);
+
+// the ring itself, only on the loop thread while no system runs
+static inline void * EventChannel_append(struct EventChannel * channel) {
+  if(channel->head - channel->tail == channel->capacity) {
+    EventChannel_grow(channel);
+  }
+  return channel->data + (size_t)(channel->head++ & (channel->capacity - 1)) * channel->size;
+}
 
-#define QUERY_EVENT(...) \
-  static uint32_t CAT(_leid, __LINE__) = 0; \
-  uint32_t CAT(_neid, __LINE__) = CAT(_leid, __LINE__); \
-  _QUERY( \
-    if(_event->id <= CAT(_leid, __LINE__)) return; \
-    if(_event->id > CAT(_neid, __LINE__)) CAT(_neid, __LINE__) = _event->id; \
-  , \
-    CAT(_leid, __LINE__) = CAT(_neid, __LINE__); \
-  , ( read, Event, _event ), ## __VA_ARGS__)
+static inline void * EventChannel_publish(struct EventChannel * channel) {
+  return CmdBuf_publish(Engine_cmd_buf(), channel);
+}
 
-uint32_t Engine_next_event_id(void);
+static inline const void * EventChannel_next(const struct EventChannel * channel, struct EventReader * reader) {
+  if(reader->cursor == channel->head) {
+    return NULL;
+  }
+  return channel->data + (size_t)(reader->cursor++ & (channel->capacity - 1)) * channel->size;
+}
+
+#define DECLARE_EVENT(IDENT, ...)                                                     \
+  struct IDENT __VA_ARGS__;                                                           \
+  extern struct EventChannel IDENT##_channel;                                         \
+  static inline struct IDENT * IDENT##_publish(void) {                                \
+    return (struct IDENT *)EventChannel_publish(&IDENT##_channel);                    \
+  }
+
+#define DEFINE_EVENT(IDENT)                                                           \
+  struct EventChannel IDENT##_channel = {                                             \
+    .name = #IDENT,                                                                   \
+    .size = sizeof(struct IDENT)                                                      \
+  };                                                                                  \
+  __attribute__((constructor)) static void IDENT##_add_channel(void) {                \
+    Engine_add_event_channel(&IDENT##_channel);                                       \
+  }
 
+#define PUBLISH_EVENT(IDENT, ...) ((void)(*IDENT##_publish() = (struct IDENT) { __VA_ARGS__ }))
+
+// READ_EVENTS(Damage, damage) { ... } runs the block once for every event this line has not seen yet. the cursor is
+// one static per line, so a line must only run on one thread at a time: not in a QUERY_PARALLEL action or in systems
+// the scheduler runs in parallel
+#define READ_EVENTS(IDENT, NAME)                                                                                 \
+  static struct EventReader ALIAS_CPP_CAT(_event_reader, __LINE__);                                              \
+  for(const struct IDENT * NAME = EventChannel_first(&IDENT##_channel, &ALIAS_CPP_CAT(_event_reader, __LINE__)); \
+      NAME != NULL;                                                                                              \
+      NAME = EventChannel_next(&IDENT##_channel, &ALIAS_CPP_CAT(_event_reader, __LINE__)))
+
+// bundles are initialized in Engine_init, before any other component registers
 #define ENGINE_COMPONENT(BUNDLE, IDENT)                                                                      \
   static inline alias_ecs_ComponentHandle alias_##IDENT##_component(void) {                                  \
     return BUNDLE()->IDENT##_component;                                                                      \
   }                                                                                                          \
+  static inline const struct alias_##IDENT * alias_##IDENT##_read_cached(                                    \
+      struct ComponentCache * cache, Entity entity) {                                                        \
+    return (const struct alias_##IDENT *)ComponentCache_read(cache, entity, BUNDLE()->IDENT##_component);    \
+  }                                                                                                          \
   static inline const struct alias_##IDENT * alias_##IDENT##_read(Entity entity) {                           \
     const struct alias_##IDENT * ptr;                                                                        \
     alias_ecs_read_entity_component(Engine_ecs(), entity, BUNDLE()->IDENT##_component, (const void **)&ptr); \
@@ -250,7 +481,11 @@ uint32_t Engine_next_event_id(void);
 // transform
 #include <alias/transform.h>
 
-alias_TransformBundle * Engine_transform_bundle(void);
+extern alias_TransformBundle _engine_transform_bundle;
+
+static inline alias_TransformBundle * Engine_transform_bundle(void) {
+  return &_engine_transform_bundle;
+}
 
 ENGINE_COMPONENT(Engine_transform_bundle, Translation2D)
 ENGINE_COMPONENT(Engine_transform_bundle, Rotation2D)
@@ -261,7 +496,11 @@ ENGINE_COMPONENT(Engine_transform_bundle, Parent2D)
 // physics
 #include <alias/physics.h>
 
-alias_Physics2DBundle * Engine_physics_2d_bundle(void);
+extern alias_Physics2DBundle _engine_physics_2d_bundle;
+
+static inline alias_Physics2DBundle * Engine_physics_2d_bundle(void) {
+  return &_engine_physics_2d_bundle;
+}
 
 ENGINE_COMPONENT(Engine_physics_2d_bundle, Physics2DMotion)
 ENGINE_COMPONENT(Engine_physics_2d_bundle, Physics2DBodyMotion)
@@ -269,6 +508,13 @@ ENGINE_COMPONENT(Engine_physics_2d_bundle, Physics2DMass)
 ENGINE_COMPONENT(Engine_physics_2d_bundle, Physics2DDampen)
 ENGINE_COMPONENT(Engine_physics_2d_bundle, Physics2DGravity)
 
+// entities with this are drawn between their last two physics steps
+DECLARE_COMPONENT(PreviousLocalToWorld2D, {
+  alias_pga2d_Motor motor;
+  alias_pga2d_Point position;
+  bool valid;
+})
+
 // render
 struct LoadedResource;
 
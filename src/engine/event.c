@@ -0,0 +1,63 @@
+#include "engine.h"
+
+#include <string.h>
+
+#define EVENT_MIN_CAPACITY 64
+#define EVENT_ALIGN        16
+
+static struct EventChannel * _event_channels;
+
+void Engine_add_event_channel(struct EventChannel * channel) {
+  channel->next = _event_channels;
+  _event_channels = channel;
+}
+
+// only ever grows, once a channel has seen its busiest two frames publishing stops allocating. an event sits at its
+// number masked by the capacity, so each moves to where its number lands in the new ring
+void EventChannel_grow(struct EventChannel * channel) {
+  uint32_t capacity = channel->capacity ? channel->capacity * 2 : EVENT_MIN_CAPACITY;
+  uint8_t * data = alias_malloc(alias_default_MemoryCB(), (size_t)capacity * channel->size, EVENT_ALIGN);
+
+  uint64_t number = channel->tail;
+  while(number < channel->head) {
+    uint32_t from = number & (channel->capacity - 1);
+    uint32_t to = number & (capacity - 1);
+    uint32_t run = alias_min(channel->head - number, alias_min(channel->capacity - from, capacity - to));
+    memcpy(data + (size_t)to * channel->size, channel->data + (size_t)from * channel->size, (size_t)run * channel->size);
+    number += run;
+  }
+
+  if(channel->data != NULL) {
+    alias_free(alias_default_MemoryCB(), channel->data, (size_t)channel->capacity * channel->size, EVENT_ALIGN);
+  }
+  channel->data = data;
+  channel->capacity = capacity;
+}
+
+const void * EventChannel_first(const struct EventChannel * channel, struct EventReader * reader) {
+  if(reader->cursor < channel->tail) {
+    reader->missed += channel->tail - reader->cursor;
+    reader->cursor = channel->tail;
+  }
+  return EventChannel_next(channel, reader);
+}
+
+// events published during a frame stay readable through the next one, so a reader that runs before the publisher
+// still sees them
+void EventChannels_update(void) {
+  for(struct EventChannel * channel = _event_channels; channel != NULL; channel = channel->next) {
+    channel->tail = channel->frame;
+    channel->frame = channel->head;
+  }
+}
+
+void EventChannels_cleanup(void) {
+  for(struct EventChannel * channel = _event_channels; channel != NULL; channel = channel->next) {
+    if(channel->data != NULL) {
+      alias_free(alias_default_MemoryCB(), channel->data, (size_t)channel->capacity * channel->size, EVENT_ALIGN);
+    }
+    channel->data = NULL;
+    channel->capacity = 0;
+    channel->tail = channel->frame = channel->head;
+  }
+}
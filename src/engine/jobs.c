@@ -0,0 +1,398 @@
+#include "engine.h"
+
+#include <alias/data_structure/vector.h>
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+// every worker and the loop thread own a Chase-Lev deque. owners push and pop at the bottom, idle threads steal from
+// the top of the others. threads that own no deque (the render thread) hand their jobs over through a locked queue and
+// only take jobs from it.
+#define JOB_DEQUE_CAPACITY 4096
+#define JOB_THREAD_NONE    ((uint32_t)-1)
+#define JOB_WAIT_SPINS     64  // idle rounds a waiting thread spins before it starts yielding
+#define JOB_WAIT_YIELDS    256 // then yields before it sleeps a millisecond at a time
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JOB_PAUSE() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define JOB_PAUSE() __asm__ __volatile__("yield")
+#else
+#define JOB_PAUSE()
+#endif
+
+struct Job {
+  void (*f)(void * ud);
+  void * ud;
+  struct JobCounter * counter;
+};
+
+struct JobDeque {
+  _Atomic int64_t top;
+  _Atomic int64_t bottom;
+  struct Job jobs[JOB_DEQUE_CAPACITY];
+};
+
+static struct {
+  uint32_t count;
+  uint32_t running;
+  _Atomic bool started;
+  uv_mutex_t start_mutex;
+  uv_thread_t * threads;
+  struct JobDeque * deques; // [0] is the loop thread, [1 + i] is worker i
+
+  _Atomic bool quit;
+  _Atomic uint32_t pending;
+  _Atomic uint32_t sleeping;
+  uv_mutex_t sleep_mutex;
+  uv_cond_t sleep_cond;
+
+  _Atomic uint32_t num_injected;
+  uv_mutex_t inject_mutex;
+  alias_Vector(struct Job) injected;
+
+  bool loop_attached;
+  uv_async_t loop_async;
+  uv_mutex_t loop_mutex;
+  alias_Vector(struct Job) loop_jobs[2]; // posting into one while the loop runs the other
+  uint32_t loop_jobs_index;
+} _jobs = { .count = (uint32_t)-1 };
+
+static uv_once_t _jobs_once = UV_ONCE_INIT;
+
+static _Thread_local uint32_t _job_thread = JOB_THREAD_NONE;
+
+static bool _deque_push(struct JobDeque * deque, struct Job job) {
+  int64_t b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+  int64_t t = atomic_load_explicit(&deque->top, memory_order_acquire);
+  if(b - t >= JOB_DEQUE_CAPACITY) {
+    return false;
+  }
+  deque->jobs[b & (JOB_DEQUE_CAPACITY - 1)] = job;
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+  return true;
+}
+
+static bool _deque_pop(struct JobDeque * deque, struct Job * job) {
+  int64_t b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+  atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  int64_t t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+  if(t > b) {
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    return false;
+  }
+
+  *job = deque->jobs[b & (JOB_DEQUE_CAPACITY - 1)];
+
+  if(t == b) {
+    // last job, race the thieves for it
+    bool won = atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    return won;
+  }
+
+  return true;
+}
+
+static bool _deque_steal(struct JobDeque * deque, struct Job * job) {
+  int64_t t = atomic_load_explicit(&deque->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  int64_t b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+  if(t >= b) {
+    return false;
+  }
+
+  *job = deque->jobs[t & (JOB_DEQUE_CAPACITY - 1)];
+
+  return atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+static void _jobs_execute(struct Job job) {
+  TRACE_ZONE("job");
+  job.f(job.ud);
+  if(job.counter != NULL) {
+    atomic_fetch_sub_explicit(&job.counter->value, 1, memory_order_release);
+  }
+}
+
+static bool _jobs_take(struct Job * job) {
+  if(!atomic_load_explicit(&_jobs.started, memory_order_acquire)) {
+    return false;
+  }
+
+  if(_job_thread != JOB_THREAD_NONE && _deque_pop(&_jobs.deques[_job_thread], job)) {
+    goto taken;
+  }
+
+  if(atomic_load_explicit(&_jobs.num_injected, memory_order_acquire) > 0) {
+    bool found = false;
+    uv_mutex_lock(&_jobs.inject_mutex);
+    if(_jobs.injected.length > 0) {
+      *job = *alias_Vector_pop(&_jobs.injected);
+      atomic_fetch_sub(&_jobs.num_injected, 1);
+      found = true;
+    }
+    uv_mutex_unlock(&_jobs.inject_mutex);
+    if(found) {
+      goto taken;
+    }
+  }
+
+  // threads without a deque only take injected jobs, the deques can be freed under them by Engine_set_worker_count
+  if(_job_thread == JOB_THREAD_NONE) {
+    return false;
+  }
+
+  uint32_t num_deques = _jobs.running + 1;
+  uint32_t start = _job_thread + 1;
+  for(uint32_t i = 0; i < num_deques; i++) {
+    uint32_t victim = (start + i) % num_deques;
+    if(victim != _job_thread && _deque_steal(&_jobs.deques[victim], job)) {
+      goto taken;
+    }
+  }
+
+  return false;
+
+taken:
+  atomic_fetch_sub(&_jobs.pending, 1);
+  return true;
+}
+
+static void _worker_f(void * arg) {
+  _job_thread = (uint32_t)(uintptr_t)arg;
+
+  char name[32];
+  snprintf(name, sizeof(name), "worker %u", _job_thread);
+  Engine_trace_thread_name(name);
+
+  while(!atomic_load(&_jobs.quit)) {
+    struct Job job;
+    if(_jobs_take(&job)) {
+      _jobs_execute(job);
+      continue;
+    }
+
+    // sleeping is published before pending is checked, a submitter publishes pending before checking sleeping
+    uv_mutex_lock(&_jobs.sleep_mutex);
+    atomic_fetch_add(&_jobs.sleeping, 1);
+    while(atomic_load(&_jobs.pending) == 0 && !atomic_load(&_jobs.quit)) {
+      uv_cond_wait(&_jobs.sleep_cond, &_jobs.sleep_mutex);
+    }
+    atomic_fetch_sub(&_jobs.sleeping, 1);
+    uv_mutex_unlock(&_jobs.sleep_mutex);
+  }
+}
+
+static void _jobs_init(void) {
+  uv_mutex_init(&_jobs.start_mutex);
+  uv_mutex_init(&_jobs.sleep_mutex);
+  uv_cond_init(&_jobs.sleep_cond);
+  uv_mutex_init(&_jobs.inject_mutex);
+  uv_mutex_init(&_jobs.loop_mutex);
+}
+
+static void _jobs_stop(void) {
+  uv_once(&_jobs_once, _jobs_init);
+  uv_mutex_lock(&_jobs.start_mutex);
+  if(!atomic_load(&_jobs.started)) {
+    uv_mutex_unlock(&_jobs.start_mutex);
+    return;
+  }
+
+  uv_mutex_lock(&_jobs.sleep_mutex);
+  atomic_store(&_jobs.quit, true);
+  uv_cond_broadcast(&_jobs.sleep_cond);
+  uv_mutex_unlock(&_jobs.sleep_mutex);
+
+  for(uint32_t i = 0; i < _jobs.running; i++) {
+    uv_thread_join(&_jobs.threads[i]);
+  }
+
+  alias_free(alias_default_MemoryCB(), _jobs.threads, sizeof(*_jobs.threads) * _jobs.running, alignof(*_jobs.threads));
+  alias_free(alias_default_MemoryCB(), _jobs.deques, sizeof(*_jobs.deques) * (_jobs.running + 1), alignof(*_jobs.deques));
+  _jobs.threads = NULL;
+  _jobs.deques = NULL;
+  _jobs.running = 0;
+  atomic_store(&_jobs.started, false);
+  uv_mutex_unlock(&_jobs.start_mutex);
+}
+
+// Jobs_init starts the pool, after Engine_set_worker_count the next job restarts it from whichever thread submits
+// first
+static void _jobs_start(void) {
+  uv_once(&_jobs_once, _jobs_init);
+  uv_mutex_lock(&_jobs.start_mutex);
+  if(atomic_load(&_jobs.started)) {
+    uv_mutex_unlock(&_jobs.start_mutex);
+    return;
+  }
+
+  uint32_t count = Engine_worker_count();
+
+  _jobs.deques = alias_malloc(alias_default_MemoryCB(), sizeof(*_jobs.deques) * (count + 1), alignof(*_jobs.deques));
+  for(uint32_t i = 0; i < count + 1; i++) {
+    atomic_init(&_jobs.deques[i].top, 0);
+    atomic_init(&_jobs.deques[i].bottom, 0);
+  }
+
+  atomic_store(&_jobs.quit, false);
+  _jobs.running = count;
+  _jobs.threads = alias_malloc(alias_default_MemoryCB(), sizeof(*_jobs.threads) * count, alignof(*_jobs.threads));
+  for(uint32_t i = 0; i < count; i++) {
+    uv_thread_create(&_jobs.threads[i], _worker_f, (void *)(uintptr_t)(i + 1));
+  }
+
+  atomic_store_explicit(&_jobs.started, true, memory_order_release);
+  uv_mutex_unlock(&_jobs.start_mutex);
+}
+
+uint32_t Engine_worker_count(void) {
+  if(_jobs.count == (uint32_t)-1) {
+    uv_cpu_info_t * infos;
+    int count;
+    if(uv_cpu_info(&infos, &count) == 0) {
+      uv_free_cpu_info(infos, count);
+      _jobs.count = count > 1 ? count - 1 : 0;
+    } else {
+      _jobs.count = 0;
+    }
+  }
+  return _jobs.count;
+}
+
+void Engine_set_worker_count(uint32_t count) {
+  // the deques are freed and made again, nothing may be queued in them
+  assert(Engine_jobs_on_loop() && atomic_load(&_jobs.pending) == 0);
+  _jobs_stop();
+  _jobs.count = count;
+}
+
+void Engine_jobs_run(void (*f)(void * ud), void * ud, struct JobCounter * counter) {
+  struct Job job = { .f = f, .ud = ud, .counter = counter };
+
+  if(counter != NULL) {
+    atomic_fetch_add_explicit(&counter->value, 1, memory_order_relaxed);
+  }
+
+  if(!atomic_load_explicit(&_jobs.started, memory_order_acquire)) {
+    _jobs_start();
+  }
+
+  if(_jobs.running == 0) {
+    _jobs_execute(job);
+    return;
+  }
+
+  if(_job_thread != JOB_THREAD_NONE) {
+    if(!_deque_push(&_jobs.deques[_job_thread], job)) {
+      _jobs_execute(job);
+      return;
+    }
+  } else {
+    uv_mutex_lock(&_jobs.inject_mutex);
+    alias_Vector_space_for(&_jobs.injected, alias_default_MemoryCB(), 1);
+    *alias_Vector_push(&_jobs.injected) = job;
+    atomic_fetch_add(&_jobs.num_injected, 1);
+    uv_mutex_unlock(&_jobs.inject_mutex);
+  }
+
+  atomic_fetch_add(&_jobs.pending, 1);
+  if(atomic_load(&_jobs.sleeping) > 0) {
+    uv_mutex_lock(&_jobs.sleep_mutex);
+    uv_cond_signal(&_jobs.sleep_cond);
+    uv_mutex_unlock(&_jobs.sleep_mutex);
+  }
+}
+
+bool Engine_jobs_done(const struct JobCounter * counter) {
+  return atomic_load_explicit(&((struct JobCounter *)counter)->value, memory_order_acquire) == 0;
+}
+
+// a wait on a long job backs off from spinning to yielding to sleeping
+void Engine_jobs_wait(struct JobCounter * counter) {
+  uint32_t idle = 0;
+  while(!Engine_jobs_done(counter)) {
+    struct Job job;
+    if(_jobs_take(&job)) {
+      _jobs_execute(job);
+      idle = 0;
+    } else if(idle < JOB_WAIT_SPINS) {
+      JOB_PAUSE();
+      idle++;
+    } else if(idle < JOB_WAIT_SPINS + JOB_WAIT_YIELDS) {
+      uv_sleep(0);
+      idle++;
+    } else {
+      uv_sleep(1);
+    }
+  }
+}
+
+static void _jobs_loop_async_f(uv_async_t * async) {
+  (void)async;
+
+  TRACE_ZONE("loop jobs");
+
+  uv_mutex_lock(&_jobs.loop_mutex);
+  uint32_t index = _jobs.loop_jobs_index;
+  _jobs.loop_jobs_index ^= 1;
+  uv_mutex_unlock(&_jobs.loop_mutex);
+
+  for(uint32_t i = 0; i < _jobs.loop_jobs[index].length; i++) {
+    _jobs_execute(_jobs.loop_jobs[index].data[i]);
+  }
+  _jobs.loop_jobs[index].length = 0;
+}
+
+void Engine_jobs_run_on_loop(void (*f)(void * ud), void * ud, struct JobCounter * counter) {
+  struct Job job = { .f = f, .ud = ud, .counter = counter };
+
+  if(counter != NULL) {
+    atomic_fetch_add_explicit(&counter->value, 1, memory_order_relaxed);
+  }
+
+  if(_job_thread == 0) {
+    _jobs_execute(job);
+    return;
+  }
+
+  uv_once(&_jobs_once, _jobs_init);
+  uv_mutex_lock(&_jobs.loop_mutex);
+  alias_Vector_space_for(&_jobs.loop_jobs[_jobs.loop_jobs_index], alias_default_MemoryCB(), 1);
+  *alias_Vector_push(&_jobs.loop_jobs[_jobs.loop_jobs_index]) = job;
+  uv_mutex_unlock(&_jobs.loop_mutex);
+
+  if(_jobs.loop_attached) {
+    uv_async_send(&_jobs.loop_async);
+  }
+}
+
+// before Engine_run the only thread is the one that will run the loop
+bool Engine_jobs_on_loop(void) {
+  return _job_thread == 0 || (_job_thread == JOB_THREAD_NONE && !_jobs.loop_attached);
+}
+
+// called from Engine_run on the loop thread
+void Jobs_init(void) {
+  _job_thread = 0;
+  Engine_trace_thread_name("loop");
+
+  uv_once(&_jobs_once, _jobs_init);
+  uv_async_init(Engine_uv_loop(), &_jobs.loop_async, _jobs_loop_async_f);
+  uv_unref((uv_handle_t *)&_jobs.loop_async);
+  _jobs.loop_attached = true;
+
+  // anything posted before the loop existed
+  uv_async_send(&_jobs.loop_async);
+
+  _jobs_start();
+}
+
+void Jobs_cleanup(void) {
+  _jobs_stop();
+}
@@ -0,0 +1,270 @@
+#include "engine.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <alias/log.h>
+
+#define QUERY_PARALLEL_MIN_CHUNK         256 // rows, smaller chunks cost more in scheduling than they win
+#define QUERY_PARALLEL_CHUNKS_PER_WORKER 4   // spare chunks let stealing even out uneven actions
+
+struct CmdScope CmdStream_enter(struct CmdScope scope);
+struct CmdScope CmdStream_fork(uint32_t count);
+
+// queries can run on the workers, scratch is linked in with a cas the first time it grows
+static struct QueryChunk * _Atomic _chunks;
+static struct QueryParallel * _Atomic _parallels;
+
+#define QUERY_LINK(HEAD, ITEM)                                                                                         \
+  do {                                                                                                                 \
+    (ITEM)->next = atomic_load(&(HEAD));                                                                               \
+    while(!atomic_compare_exchange_weak(&(HEAD), &(ITEM)->next, (ITEM))) {                                             \
+    }                                                                                                                  \
+  } while(0)
+
+// leaves *pointer alone and returns false when out of memory
+static bool _grow(void ** pointer, size_t old_size, size_t new_size, size_t align) {
+  void * grown = alias_realloc(alias_default_MemoryCB(), *pointer, old_size, new_size, align);
+  if(grown == NULL) {
+    ALIAS_ERROR("query scratch: could not grow %zu to %zu bytes", old_size, new_size);
+    return false;
+  }
+  *pointer = grown;
+  return true;
+}
+
+// capacity and states_capacity both start at 0, the first growth of either links the scratch
+static void _parallel_link(struct QueryParallel * parallel) {
+  if(parallel->capacity == 0 && parallel->states_capacity == 0) {
+    QUERY_LINK(_parallels, parallel);
+  }
+}
+
+static uint32_t _grow_capacity(uint32_t capacity) {
+  return capacity ? capacity + (capacity >> 1) : 1024;
+}
+
+// true when every pointer in data follows the matching one in first by count components
+static bool _contiguous(uint32_t num_data, const uint32_t * sizes, void * const * first, uint32_t count, void * const * data) {
+  for(uint32_t i = 0; i < num_data; i++) {
+    void * next = first[i] == NULL ? NULL : (uint8_t *)first[i] + (size_t)sizes[i] * count;
+    if(data[i] != next) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void _chunk_flush(struct QueryChunk * chunk) {
+  if(chunk->count > 0) {
+    chunk->action(chunk->ud, chunk->count, chunk->entities, chunk->data);
+    chunk->count = 0;
+  }
+}
+
+static void _chunk_gather(void * ud, alias_ecs_Instance * instance, alias_ecs_EntityHandle entity, void ** data) {
+  (void)instance;
+  struct QueryChunk * chunk = (struct QueryChunk *)ud;
+
+  if(chunk->count > 0 && !_contiguous(chunk->num_data, chunk->sizes, chunk->data, chunk->count, data)) {
+    _chunk_flush(chunk);
+  }
+
+  if(chunk->count == 0) {
+    memcpy(chunk->data, data, sizeof(*data) * chunk->num_data);
+  }
+
+  if(chunk->count == chunk->capacity) {
+    uint32_t capacity = _grow_capacity(chunk->capacity);
+    if(!_grow((void **)&chunk->entities, sizeof(*chunk->entities) * chunk->capacity, sizeof(*chunk->entities) * capacity,
+              alignof(alias_ecs_EntityHandle))) {
+      // run what fits and start over in the same scratch, without any scratch the entity is dropped
+      _chunk_flush(chunk);
+      if(chunk->capacity == 0) {
+        return;
+      }
+      memcpy(chunk->data, data, sizeof(*data) * chunk->num_data);
+    } else {
+      if(chunk->capacity == 0) {
+        QUERY_LINK(_chunks, chunk);
+      }
+      chunk->capacity = capacity;
+    }
+  }
+  chunk->entities[chunk->count++] = entity;
+}
+
+void QueryChunk_execute(struct QueryChunk * chunk, alias_ecs_Query * query, void * ud, void (*action)(void * ud, uint32_t count, const alias_ecs_EntityHandle * entities, void ** data)) {
+  assert(chunk->num_data <= MAX_SYSTEM_ACCESS);
+
+  chunk->count = 0;
+  chunk->ud = ud;
+  chunk->action = action;
+
+  alias_ecs_execute_query(Engine_ecs(), query, (alias_ecs_QueryCB) { _chunk_gather, chunk });
+  _chunk_flush(chunk);
+}
+
+struct QueryParallelChunk {
+  struct QueryParallel * parallel;
+  void (*action)(void * ud, alias_ecs_Instance * instance, alias_ecs_EntityHandle entity, void ** data);
+  void (*chunk_action)(void * ud, uint32_t count, const alias_ecs_EntityHandle * entities, void ** data);
+  uint32_t index;
+  uint32_t start;
+  uint32_t end;
+  struct CmdScope cmd;
+};
+
+static void _gather(void * ud, alias_ecs_Instance * instance, alias_ecs_EntityHandle entity, void ** data) {
+  (void)instance;
+  struct QueryParallel * parallel = (struct QueryParallel *)ud;
+
+  if(parallel->num_rows == parallel->capacity) {
+    uint32_t capacity = _grow_capacity(parallel->capacity);
+    size_t entities_size = sizeof(*parallel->entities) * parallel->capacity;
+    size_t data_size = parallel->data ? sizeof(*parallel->data) * ((size_t)parallel->capacity * parallel->num_data + 1) : 0;
+    if(!_grow((void **)&parallel->entities, entities_size, sizeof(*parallel->entities) * capacity,
+              alignof(alias_ecs_EntityHandle))) {
+      return;
+    }
+    if(!_grow((void **)&parallel->data, data_size, sizeof(*parallel->data) * ((size_t)capacity * parallel->num_data + 1),
+              alignof(void *))) {
+      // give the entities back so both match the old capacity, shrinking keeps the block
+      _grow((void **)&parallel->entities, sizeof(*parallel->entities) * capacity, entities_size,
+            alignof(alias_ecs_EntityHandle));
+      return;
+    }
+    _parallel_link(parallel);
+    parallel->capacity = capacity;
+  }
+
+  parallel->entities[parallel->num_rows] = entity;
+  memcpy(parallel->data + parallel->num_rows * parallel->num_data, data, sizeof(*data) * parallel->num_data);
+  parallel->num_rows++;
+}
+
+static void _run_chunk(void * ud) {
+  struct QueryParallelChunk * chunk = (struct QueryParallelChunk *)ud;
+  struct QueryParallel * parallel = chunk->parallel;
+  alias_ecs_Instance * instance = Engine_ecs();
+
+  TRACE_ZONE("query chunk");
+
+  void * state = (uint8_t *)parallel->states + chunk->index * parallel->state_size;
+  struct CmdScope previous = CmdStream_enter(chunk->cmd);
+
+  if(chunk->action != NULL) {
+    for(uint32_t row = chunk->start; row < chunk->end; row++) {
+      chunk->action(state, instance, parallel->entities[row], parallel->data + row * parallel->num_data);
+    }
+    CmdStream_enter(previous);
+    return;
+  }
+
+  // split the rows into runs that are contiguous in the ecs storage
+  uint32_t start = chunk->start;
+  while(start < chunk->end) {
+    void ** first = parallel->data + start * parallel->num_data;
+    uint32_t count = 1;
+    while(start + count < chunk->end && _contiguous(parallel->num_data, parallel->sizes, first, count, first + count * parallel->num_data)) {
+      count++;
+    }
+    chunk->chunk_action(state, count, parallel->entities + start, first);
+    start += count;
+  }
+
+  CmdStream_enter(previous);
+}
+
+static void _parallel_execute(
+    struct QueryParallel * parallel
+  , alias_ecs_Query * query
+  , const void * state
+  , size_t state_size
+  , void (*action)(void * ud, alias_ecs_Instance * instance, alias_ecs_EntityHandle entity, void ** data)
+  , void (*chunk_action)(void * ud, uint32_t count, const alias_ecs_EntityHandle * entities, void ** data)
+  ) {
+  parallel->num_rows = 0;
+  alias_ecs_execute_query(Engine_ecs(), query, (alias_ecs_QueryCB) { _gather, parallel });
+
+  uint32_t max_chunks = (Engine_worker_count() + 1) * QUERY_PARALLEL_CHUNKS_PER_WORKER;
+  uint32_t num_chunks = (parallel->num_rows + QUERY_PARALLEL_MIN_CHUNK - 1) / QUERY_PARALLEL_MIN_CHUNK;
+  num_chunks = num_chunks < 1 ? 1 : num_chunks > max_chunks ? max_chunks : num_chunks;
+
+  // state_size is fixed per query, so the old bytes are states_capacity of them
+  if(parallel->states_capacity < num_chunks) {
+    if(_grow(&parallel->states, parallel->states_capacity * state_size, num_chunks * state_size, alignof(max_align_t))) {
+      _parallel_link(parallel);
+      parallel->states_capacity = num_chunks;
+    } else if(parallel->states_capacity > 0) {
+      // fewer chunks still run every row
+      num_chunks = parallel->states_capacity;
+    } else {
+      parallel->num_chunks = 0;
+      return;
+    }
+  }
+  parallel->state_size = state_size;
+  parallel->num_chunks = num_chunks;
+  for(uint32_t i = 0; i < num_chunks; i++) {
+    memcpy((uint8_t *)parallel->states + i * state_size, state, state_size);
+  }
+
+  // chunk i records into buffer i, commands come out in row order however the chunks were spread over the workers
+  struct CmdScope cmd = CmdStream_fork(num_chunks);
+
+  struct QueryParallelChunk chunks[num_chunks];
+  struct JobCounter counter = { 0 };
+  for(uint32_t i = 0; i < num_chunks; i++) {
+    chunks[i] = (struct QueryParallelChunk) {
+        .parallel = parallel
+      , .action = action
+      , .chunk_action = chunk_action
+      , .index = i
+      , .start = (uint32_t)((uint64_t)parallel->num_rows * i / num_chunks)
+      , .end = (uint32_t)((uint64_t)parallel->num_rows * (i + 1) / num_chunks)
+      , .cmd = { .stream = cmd.stream, .index = cmd.index + i }
+    };
+    if(i + 1 < num_chunks) {
+      Engine_jobs_run(_run_chunk, &chunks[i], &counter);
+    }
+  }
+
+  // the calling thread takes the last chunk itself
+  _run_chunk(&chunks[num_chunks - 1]);
+  Engine_jobs_wait(&counter);
+}
+
+void QueryParallel_execute(struct QueryParallel * parallel, alias_ecs_Query * query, const void * state, size_t state_size, void (*action)(void * ud, alias_ecs_Instance * instance, alias_ecs_EntityHandle entity, void ** data)) {
+  _parallel_execute(parallel, query, state, state_size, action, NULL);
+}
+
+void QueryParallel_execute_chunks(struct QueryParallel * parallel, alias_ecs_Query * query, const void * state, size_t state_size, void (*action)(void * ud, uint32_t count, const alias_ecs_EntityHandle * entities, void ** data)) {
+  _parallel_execute(parallel, query, state, state_size, NULL, action);
+}
+
+void Query_cleanup(void) {
+  for(struct QueryChunk * chunk = atomic_exchange(&_chunks, NULL); chunk != NULL; chunk = chunk->next) {
+    alias_free(alias_default_MemoryCB(), chunk->entities, sizeof(*chunk->entities) * chunk->capacity,
+               alignof(alias_ecs_EntityHandle));
+    chunk->entities = NULL;
+    chunk->capacity = 0;
+  }
+  for(struct QueryParallel * parallel = atomic_exchange(&_parallels, NULL); parallel != NULL; parallel = parallel->next) {
+    if(parallel->capacity > 0) {
+      alias_free(alias_default_MemoryCB(), parallel->entities, sizeof(*parallel->entities) * parallel->capacity,
+                 alignof(alias_ecs_EntityHandle));
+      alias_free(alias_default_MemoryCB(), parallel->data,
+                 sizeof(*parallel->data) * ((size_t)parallel->capacity * parallel->num_data + 1), alignof(void *));
+    }
+    if(parallel->states_capacity > 0) {
+      alias_free(alias_default_MemoryCB(), parallel->states, parallel->states_capacity * parallel->state_size,
+                 alignof(max_align_t));
+    }
+    parallel->entities = NULL;
+    parallel->data = NULL;
+    parallel->states = NULL;
+    parallel->capacity = parallel->states_capacity = 0;
+  }
+}
@@ -0,0 +1,174 @@
+#include "engine.h"
+
+#include <stdatomic.h>
+
+struct CmdScope CmdStream_enter(struct CmdScope scope);
+void CmdStream_execute(struct CmdStream * stream, alias_ecs_Instance * instance);
+void CmdStream_execute_loop(alias_ecs_Instance * instance);
+
+// systems are ordered by registration. a system depends on every earlier system it conflicts with (one writes a
+// component the other reads or writes), so any execution that respects the dependencies gives the same result as
+// running them in order, no matter how many workers take part.
+struct Schedule;
+
+struct ScheduleNode {
+  struct Schedule * schedule;
+  uint32_t index;
+};
+
+struct Schedule {
+  uint32_t num_systems;
+  const struct System * systems;
+  bool warm;
+
+  uint32_t * num_dependencies;
+  uint32_t * successors_start;
+  uint32_t * successors;
+
+  struct ScheduleNode * nodes;
+  _Atomic uint32_t * remaining;
+  struct JobCounter counter;
+
+  struct CmdStream * streams;
+};
+
+static bool _components_overlap(uint32_t num_a, const alias_ecs_ComponentHandle * a, uint32_t num_b, const alias_ecs_ComponentHandle * b) {
+  for(uint32_t i = 0; i < num_a; i++) {
+    for(uint32_t j = 0; j < num_b; j++) {
+      if(a[i] == b[j]) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+static bool _systems_conflict(const struct SystemAccess * a, const struct SystemAccess * b) {
+  return _components_overlap(a->num_write, a->write, b->num_write, b->write)
+      || _components_overlap(a->num_write, a->write, b->num_read, b->read)
+      || _components_overlap(a->num_read, a->read, b->num_write, b->write)
+      ;
+}
+
+static struct Schedule * _schedule_create(uint32_t num_systems, const struct System * systems) {
+  struct Schedule * schedule = alias_malloc(alias_default_MemoryCB(), sizeof(*schedule), alignof(*schedule));
+  schedule->num_systems = num_systems;
+  schedule->systems = systems;
+  schedule->warm = false;
+
+  struct SystemAccess * access = alias_malloc(alias_default_MemoryCB(), sizeof(*access) * num_systems, alignof(*access));
+  for(uint32_t i = 0; i < num_systems; i++) {
+    systems[i].access(&access[i]);
+  }
+
+  bool * edges = alias_malloc(alias_default_MemoryCB(), sizeof(*edges) * num_systems * num_systems, alignof(*edges));
+  uint32_t num_edges = 0;
+  for(uint32_t i = 0; i < num_systems; i++) {
+    for(uint32_t j = 0; j < num_systems; j++) {
+      edges[i * num_systems + j] = i < j && _systems_conflict(&access[i], &access[j]);
+      num_edges += edges[i * num_systems + j];
+    }
+  }
+
+  schedule->num_dependencies = alias_malloc(alias_default_MemoryCB(), sizeof(uint32_t) * num_systems, alignof(uint32_t));
+  schedule->successors_start = alias_malloc(alias_default_MemoryCB(), sizeof(uint32_t) * (num_systems + 1), alignof(uint32_t));
+  schedule->successors = alias_malloc(alias_default_MemoryCB(), sizeof(uint32_t) * (num_edges + 1), alignof(uint32_t));
+  schedule->nodes = alias_malloc(alias_default_MemoryCB(), sizeof(*schedule->nodes) * num_systems, alignof(*schedule->nodes));
+  schedule->remaining = alias_malloc(alias_default_MemoryCB(), sizeof(*schedule->remaining) * num_systems, alignof(*schedule->remaining));
+  schedule->streams = alias_malloc(alias_default_MemoryCB(), sizeof(*schedule->streams) * num_systems, alignof(*schedule->streams));
+  alias_memory_clear(schedule->streams, sizeof(*schedule->streams) * num_systems);
+
+  uint32_t k = 0;
+  for(uint32_t i = 0; i < num_systems; i++) {
+    schedule->nodes[i].schedule = schedule;
+    schedule->nodes[i].index = i;
+    schedule->num_dependencies[i] = 0;
+    schedule->successors_start[i] = k;
+    for(uint32_t j = 0; j < num_systems; j++) {
+      schedule->num_dependencies[i] += edges[j * num_systems + i];
+      if(edges[i * num_systems + j]) {
+        schedule->successors[k++] = j;
+      }
+    }
+  }
+  schedule->successors_start[num_systems] = k;
+
+  alias_free(alias_default_MemoryCB(), edges, sizeof(*edges) * num_systems * num_systems, alignof(*edges));
+  alias_free(alias_default_MemoryCB(), access, sizeof(*access) * num_systems, alignof(*access));
+
+  return schedule;
+}
+
+// the thread running a system records into its stream, a waiting thread may pick up another system in between
+static void _schedule_run_system(struct Schedule * schedule, uint32_t index) {
+  struct CmdScope previous = CmdStream_enter((struct CmdScope) { .stream = &schedule->streams[index], .index = 0 });
+  schedule->systems[index].run();
+  CmdStream_enter(previous);
+}
+
+// the sync point, commands apply in system order whichever thread recorded them
+static void _schedule_apply_commands(struct Schedule * schedule) {
+  TRACE_ZONE("apply commands");
+  for(uint32_t i = 0; i < schedule->num_systems; i++) {
+    CmdStream_execute(&schedule->streams[i], Engine_ecs());
+  }
+  CmdStream_execute_loop(Engine_ecs());
+}
+
+// successors are submitted before this job retires from the counter, so it only reaches zero once every system ran
+static void _schedule_run_f(void * ud) {
+  struct ScheduleNode * node = (struct ScheduleNode *)ud;
+  struct Schedule * schedule = node->schedule;
+
+  _schedule_run_system(schedule, node->index);
+
+  for(uint32_t k = schedule->successors_start[node->index]; k < schedule->successors_start[node->index + 1]; k++) {
+    uint32_t successor = schedule->successors[k];
+    if(atomic_fetch_sub(&schedule->remaining[successor], 1) == 1) {
+      Engine_jobs_run(_schedule_run_f, &schedule->nodes[successor], &schedule->counter);
+    }
+  }
+}
+
+static bool _parallel_systems = false;
+
+bool Engine_parallel_systems(void) {
+  return _parallel_systems;
+}
+
+void Engine_set_parallel_systems(bool enabled) {
+  _parallel_systems = enabled;
+}
+
+void Engine_run_systems(uint32_t num_systems, const struct System * systems, struct Schedule ** schedule_ptr) {
+  if(*schedule_ptr == NULL) {
+    *schedule_ptr = _schedule_create(num_systems, systems);
+  }
+  struct Schedule * schedule = *schedule_ptr;
+
+  // the first run is serial, queries and components are created lazily on first use
+  if(!schedule->warm || !_parallel_systems || Engine_worker_count() == 0) {
+    for(uint32_t i = 0; i < num_systems; i++) {
+      _schedule_run_system(schedule, i);
+    }
+    schedule->warm = true;
+    _schedule_apply_commands(schedule);
+    return;
+  }
+
+  for(uint32_t i = 0; i < num_systems; i++) {
+    atomic_store(&schedule->remaining[i], schedule->num_dependencies[i]);
+  }
+  atomic_store(&schedule->counter.value, 0);
+
+  for(uint32_t i = 0; i < num_systems; i++) {
+    if(schedule->num_dependencies[i] == 0) {
+      Engine_jobs_run(_schedule_run_f, &schedule->nodes[i], &schedule->counter);
+    }
+  }
+
+  // the calling thread works too
+  Engine_jobs_wait(&schedule->counter);
+
+  _schedule_apply_commands(schedule);
+}
@@ -0,0 +1,513 @@
+#include "engine.h"
+
+#include <alias/data_structure/vector.h>
+#include <alias/log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct ComponentRegistration * Component_registrations(void);
+
+// ====================================================================================================================
+// Format =============================================================================================================
+// a snapshot is a header, a directory of the components it uses and one table per set of components. a table is its
+// row count and directory indexes followed by one column per component, count * size bytes each. entities are
+// numbered in table order and references between them are stored as that number plus one, 0 is a reference to
+// nothing or to an entity outside of the snapshot. pointers into static data are stored relative to _snapshot_anchor.
+// the header, the directory, every table header and every column are padded to SNAPSHOT_ALIGN so columns can be
+// spawned straight out of the loaded file
+#define SNAPSHOT_ALIGN       16
+#define SNAPSHOT_NAME_LENGTH 56
+#define SNAPSHOT_MAX_COMPONENTS 64
+
+// bump when the format changes
+#define SNAPSHOT_VERSION     2
+
+static const char _snapshot_magic[4] = { 'A', 'W', 'S', '1' };
+
+struct SnapshotHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t num_components;
+  uint32_t num_tables;
+  uint32_t num_entities;
+};
+
+struct SnapshotComponent {
+  char name[SNAPSHOT_NAME_LENGTH];
+  uint32_t size;
+  uint32_t reserved;
+};
+
+struct SnapshotTable {
+  uint32_t count;
+  uint32_t num_components;
+};
+
+static const uint8_t _snapshot_anchor;
+
+static alias_ecs_LayerHandle _snapshot_layer = ALIAS_ECS_INVALID_LAYER;
+
+alias_ecs_LayerHandle Snapshot_layer(void) {
+  return _snapshot_layer;
+}
+
+static inline size_t _snapshot_pad(size_t size) {
+  return (size + SNAPSHOT_ALIGN - 1) & ~(size_t)(SNAPSHOT_ALIGN - 1);
+}
+
+// ====================================================================================================================
+// Components =========================================================================================================
+// the transform and physics components come from bundles instead of the registry
+static void _parent_2d_entities(void * data, Entity (*map)(void * ud, Entity entity), void * ud) {
+  struct alias_Parent2D * parent = (struct alias_Parent2D *)data;
+  parent->value = map(ud, parent->value);
+}
+
+#define SNAPSHOT_BUNDLE_COMPONENT(BUNDLE, IDENT, ...) \
+  { .name = "alias_" #IDENT, .handle = &BUNDLE.IDENT##_component, .size = sizeof(struct alias_##IDENT), ## __VA_ARGS__ }
+
+static struct ComponentRegistration _bundle_components[] = {
+    SNAPSHOT_BUNDLE_COMPONENT(_engine_transform_bundle, Translation2D)
+  , SNAPSHOT_BUNDLE_COMPONENT(_engine_transform_bundle, Rotation2D)
+  , SNAPSHOT_BUNDLE_COMPONENT(_engine_transform_bundle, Transform2D)
+  , SNAPSHOT_BUNDLE_COMPONENT(_engine_transform_bundle, LocalToWorld2D)
+  , SNAPSHOT_BUNDLE_COMPONENT(_engine_transform_bundle, Parent2D, .snapshot_entities = _parent_2d_entities)
+  , SNAPSHOT_BUNDLE_COMPONENT(_engine_physics_2d_bundle, Physics2DMotion)
+  , SNAPSHOT_BUNDLE_COMPONENT(_engine_physics_2d_bundle, Physics2DBodyMotion)
+  , SNAPSHOT_BUNDLE_COMPONENT(_engine_physics_2d_bundle, Physics2DMass)
+  , SNAPSHOT_BUNDLE_COMPONENT(_engine_physics_2d_bundle, Physics2DDampen)
+  , SNAPSHOT_BUNDLE_COMPONENT(_engine_physics_2d_bundle, Physics2DGravity)
+};
+
+#undef SNAPSHOT_BUNDLE_COMPONENT
+
+// every component a snapshot can hold, in a fixed order so a set of them fits in a mask
+static uint32_t _snapshot_components(const struct ComponentRegistration * components[SNAPSHOT_MAX_COMPONENTS]) {
+  uint32_t count = 0;
+
+  #define ADD(R) \
+    if(!(R)->transient && *(R)->handle != ALIAS_ECS_INVALID_COMPONENT) { \
+      if(count == SNAPSHOT_MAX_COMPONENTS) { \
+        ALIAS_ERROR("more than %u components, %s is left out of snapshots", SNAPSHOT_MAX_COMPONENTS, (R)->name); \
+      } else { \
+        components[count++] = (R); \
+      } \
+    }
+  for(uint32_t i = 0; i < sizeof(_bundle_components) / sizeof(_bundle_components[0]); i++) {
+    ADD(&_bundle_components[i])
+  }
+  for(struct ComponentRegistration * r = Component_registrations(); r != NULL; r = r->next) {
+    ADD(r)
+  }
+  #undef ADD
+
+  return count;
+}
+
+// ====================================================================================================================
+// Save ===============================================================================================================
+struct SnapshotEntity {
+  Entity entity;
+  uint32_t index;
+};
+
+struct SnapshotSaveTable {
+  uint64_t mask;
+  uint32_t count;
+  uint32_t first;
+};
+
+static int _snapshot_entity_compare(const void * ap, const void * bp) {
+  Entity a = ((const struct SnapshotEntity *)ap)->entity;
+  Entity b = ((const struct SnapshotEntity *)bp)->entity;
+  return (a > b) - (a < b);
+}
+
+// row + 1, entities outside of the snapshot are dropped to 0
+static Entity _snapshot_save_map(void * ud, Entity entity) {
+  const alias_Vector(struct SnapshotEntity) * sorted = ud;
+  struct SnapshotEntity key = { .entity = entity };
+  const struct SnapshotEntity * found = bsearch(&key, sorted->data, sorted->length, sizeof(key), _snapshot_entity_compare);
+  return found != NULL ? (Entity)found->index + 1 : 0;
+}
+
+static void _snapshot_write_pad(FILE * file, size_t size) {
+  static const uint8_t zero[SNAPSHOT_ALIGN] = { 0 };
+  fwrite(zero, _snapshot_pad(size) - size, 1, file);
+}
+
+bool Engine_snapshot_save(const char * path, uint32_t count, const Entity * entities) {
+  TRACE_ZONE("snapshot save");
+
+  const struct ComponentRegistration * components[SNAPSHOT_MAX_COMPONENTS];
+  uint32_t num_components = _snapshot_components(components);
+
+  alias_MemoryCB * mcb = alias_default_MemoryCB();
+  alias_Vector(struct SnapshotSaveTable) tables = ALIAS_VECTOR_INIT;
+  alias_Vector(struct SnapshotEntity) sorted = ALIAS_VECTOR_INIT;
+  uint32_t * table_of = alias_malloc(mcb, sizeof(*table_of) * count, alignof(*table_of));
+  Entity * rows = NULL;
+  uint32_t num_entities = 0;
+  uint64_t used = 0;
+  uint32_t max_size = 0;
+  bool result = false;
+
+  // group the entities by the components they have, one with none of them has nothing to save
+  for(uint32_t i = 0; i < count; i++) {
+    uint64_t mask = 0;
+    for(uint32_t c = 0; c < num_components; c++) {
+      const void * data;
+      if(alias_ecs_read_entity_component(Engine_ecs(), entities[i], *components[c]->handle, &data) == ALIAS_ECS_SUCCESS) {
+        mask |= (uint64_t)1 << c;
+      }
+    }
+    used |= mask;
+    if(mask == 0) {
+      table_of[i] = UINT32_MAX;
+      continue;
+    }
+
+    uint32_t t = 0;
+    while(t < tables.length && tables.data[t].mask != mask) {
+      t++;
+    }
+    if(t == tables.length) {
+      alias_Vector_space_for(&tables, mcb, 1);
+      *alias_Vector_push(&tables) = (struct SnapshotSaveTable) { .mask = mask };
+    }
+    tables.data[t].count++;
+    table_of[i] = t;
+  }
+
+  // number the entities in table order
+  for(uint32_t t = 0; t < tables.length; t++) {
+    tables.data[t].first = num_entities;
+    num_entities += tables.data[t].count;
+  }
+  alias_Vector_space_for(&sorted, mcb, num_entities);
+  for(uint32_t t = 0; t < tables.length; t++) {
+    tables.data[t].count = 0;
+  }
+  for(uint32_t i = 0; i < count; i++) {
+    if(table_of[i] != UINT32_MAX) {
+      struct SnapshotSaveTable * table = &tables.data[table_of[i]];
+      *alias_Vector_push(&sorted) = (struct SnapshotEntity) { .entity = entities[i], .index = table->first + table->count++ };
+    }
+  }
+
+  // rows are written table by table, entities holds them in their original order
+  rows = alias_malloc(mcb, sizeof(*rows) * alias_max(num_entities, 1), alignof(*rows));
+  for(uint32_t i = 0; i < sorted.length; i++) {
+    rows[sorted.data[i].index] = sorted.data[i].entity;
+  }
+  qsort(sorted.data, sorted.length, sizeof(*sorted.data), _snapshot_entity_compare);
+
+  FILE * file = fopen(path, "wb");
+  if(file == NULL) {
+    ALIAS_ERROR("could not open snapshot %s", path);
+    goto cleanup;
+  }
+
+  uint32_t directory[SNAPSHOT_MAX_COMPONENTS];
+  struct SnapshotHeader header = { .version = SNAPSHOT_VERSION, .num_tables = tables.length, .num_entities = num_entities };
+  alias_memory_copy(header.magic, sizeof(header.magic), _snapshot_magic, sizeof(_snapshot_magic));
+  for(uint32_t c = 0; c < num_components; c++) {
+    if(used & ((uint64_t)1 << c)) {
+      directory[c] = header.num_components++;
+      max_size = alias_max(max_size, components[c]->size);
+    }
+  }
+  fwrite(&header, sizeof(header), 1, file);
+  _snapshot_write_pad(file, sizeof(header));
+
+  for(uint32_t c = 0; c < num_components; c++) {
+    if(used & ((uint64_t)1 << c)) {
+      struct SnapshotComponent component = { .size = components[c]->size };
+      strncpy(component.name, components[c]->name, sizeof(component.name) - 1);
+      fwrite(&component, sizeof(component), 1, file);
+    }
+  }
+  _snapshot_write_pad(file, sizeof(struct SnapshotComponent) * header.num_components);
+
+  uint8_t * row = alias_malloc(mcb, alias_max(max_size, 1), SNAPSHOT_ALIGN);
+  for(uint32_t t = 0; t < tables.length; t++) {
+    const struct SnapshotSaveTable * table = &tables.data[t];
+
+    struct SnapshotTable table_header = { .count = table->count, .num_components = __builtin_popcountll(table->mask) };
+    fwrite(&table_header, sizeof(table_header), 1, file);
+    for(uint32_t c = 0; c < num_components; c++) {
+      if(table->mask & ((uint64_t)1 << c)) {
+        fwrite(&directory[c], sizeof(directory[c]), 1, file);
+      }
+    }
+    _snapshot_write_pad(file, sizeof(table_header) + sizeof(uint32_t) * table_header.num_components);
+
+    for(uint32_t c = 0; c < num_components; c++) {
+      const struct ComponentRegistration * component = components[c];
+      if(!(table->mask & ((uint64_t)1 << c)) || component->size == 0) {
+        continue;
+      }
+      for(uint32_t r = 0; r < table->count; r++) {
+        const void * data;
+        alias_ecs_read_entity_component(Engine_ecs(), rows[table->first + r], *component->handle, &data);
+        alias_memory_copy(row, component->size, data, component->size);
+        if(component->snapshot_entities != NULL) {
+          component->snapshot_entities(row, _snapshot_save_map, &sorted);
+        }
+        if(component->snapshot_pointers != NULL) {
+          component->snapshot_pointers(row, -(intptr_t)&_snapshot_anchor);
+        }
+        fwrite(row, component->size, 1, file);
+      }
+      _snapshot_write_pad(file, (size_t)component->size * table->count);
+    }
+  }
+  alias_free(mcb, row, alias_max(max_size, 1), SNAPSHOT_ALIGN);
+
+  result = ferror(file) == 0;
+  if(fclose(file) != 0 || !result) {
+    ALIAS_ERROR("could not write snapshot %s", path);
+    result = false;
+  }
+
+cleanup:
+  alias_free(mcb, table_of, sizeof(*table_of) * count, alignof(*table_of));
+  if(rows != NULL) {
+    alias_free(mcb, rows, sizeof(*rows) * alias_max(num_entities, 1), alignof(*rows));
+  }
+  alias_Vector_free(&tables, mcb);
+  alias_Vector_free(&sorted, mcb);
+  return result;
+}
+
+// ====================================================================================================================
+// Load ===============================================================================================================
+struct SnapshotLoadMap {
+  const Entity * entities;
+  uint32_t num_entities;
+};
+
+static Entity _snapshot_load_map(void * ud, Entity entity) {
+  const struct SnapshotLoadMap * load = ud;
+  return entity > 0 && entity <= load->num_entities ? load->entities[entity - 1] : ALIAS_ECS_INVALID_ENTITY;
+}
+
+// bounds checked walk over the loaded file
+struct SnapshotReader {
+  uint8_t * data;
+  size_t size;
+  size_t offset;
+};
+
+static void * _snapshot_read(struct SnapshotReader * reader, size_t size) {
+  if(size > reader->size - reader->offset) {
+    return NULL;
+  }
+  void * at = reader->data + reader->offset;
+  reader->offset += size;
+  return at;
+}
+
+static void * _snapshot_read_padded(struct SnapshotReader * reader, size_t size) {
+  void * at = _snapshot_read(reader, size);
+  if(at != NULL) {
+    reader->offset = alias_min(reader->size, _snapshot_pad(reader->offset));
+  }
+  return at;
+}
+
+struct SnapshotLoadTable {
+  uint32_t count;
+  uint32_t num_components;
+  const struct ComponentRegistration * components[SNAPSHOT_MAX_COMPONENTS];
+  uint8_t * columns[SNAPSHOT_MAX_COMPONENTS];
+};
+
+// reads the next table, false when it does not fit the file
+static bool _snapshot_next_table(struct SnapshotReader * reader, const struct ComponentRegistration ** directory, uint32_t num_directory, struct SnapshotLoadTable * out) {
+  const struct SnapshotTable * table = _snapshot_read(reader, sizeof(*table));
+  if(table == NULL || table->num_components > SNAPSHOT_MAX_COMPONENTS) {
+    return false;
+  }
+  const uint32_t * indexes = _snapshot_read_padded(reader, sizeof(*indexes) * table->num_components);
+  if(indexes == NULL) {
+    return false;
+  }
+
+  out->count = table->count;
+  out->num_components = table->num_components;
+  for(uint32_t c = 0; c < table->num_components; c++) {
+    if(indexes[c] >= num_directory) {
+      return false;
+    }
+    const struct ComponentRegistration * component = directory[indexes[c]];
+    out->components[c] = component;
+    out->columns[c] = NULL;
+    if(component->size != 0) {
+      out->columns[c] = _snapshot_read_padded(reader, (size_t)component->size * table->count);
+      if(out->columns[c] == NULL) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool Engine_snapshot_load(const char * path, alias_ecs_LayerHandle layer, uint32_t * num_entities_out, Entity ** entities_out) {
+  TRACE_ZONE("snapshot load");
+
+  FILE * file = fopen(path, "rb");
+  if(file == NULL) {
+    ALIAS_ERROR("could not open snapshot %s", path);
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  long file_size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if(file_size < (long)sizeof(struct SnapshotHeader)) {
+    ALIAS_ERROR("%s is not a snapshot", path);
+    fclose(file);
+    return false;
+  }
+
+  // the whole file is read at once, columns are spawned from it in place
+  alias_MemoryCB * mcb = alias_default_MemoryCB();
+  struct SnapshotReader reader = { .data = alias_malloc(mcb, file_size, SNAPSHOT_ALIGN), .size = file_size };
+  bool read = fread(reader.data, file_size, 1, file) == 1;
+  fclose(file);
+
+  const struct ComponentRegistration * components[SNAPSHOT_MAX_COMPONENTS];
+  uint32_t num_components = _snapshot_components(components);
+  const struct ComponentRegistration ** directory = NULL;
+  uint32_t num_directory = 0;
+  struct SnapshotLoadTable table;
+  bool result = false;
+
+  const struct SnapshotHeader * header = read ? _snapshot_read_padded(&reader, sizeof(*header)) : NULL;
+  if(header == NULL || memcmp(header->magic, _snapshot_magic, sizeof(_snapshot_magic)) != 0) {
+    ALIAS_ERROR("%s is not a snapshot", path);
+    goto cleanup;
+  }
+  if(header->version != SNAPSHOT_VERSION) {
+    ALIAS_ERROR("snapshot %s is version %u, this build reads version %u", path, header->version, SNAPSHOT_VERSION);
+    goto cleanup;
+  }
+
+  // components are matched by name, a size that changed means the layout did too
+  const struct SnapshotComponent * saved = _snapshot_read_padded(&reader, sizeof(*saved) * header->num_components);
+  if(saved == NULL) {
+    goto truncated;
+  }
+  num_directory = header->num_components;
+  directory = alias_malloc(mcb, sizeof(*directory) * alias_max(num_directory, 1), alignof(*directory));
+  for(uint32_t d = 0; d < num_directory; d++) {
+    directory[d] = NULL;
+    for(uint32_t c = 0; c < num_components; c++) {
+      if(strncmp(components[c]->name, saved[d].name, sizeof(saved[d].name)) == 0) {
+        directory[d] = components[c];
+        break;
+      }
+    }
+    if(directory[d] == NULL || directory[d]->size != saved[d].size) {
+      ALIAS_ERROR("snapshot %s has component %.*s that this build does not match", path, SNAPSHOT_NAME_LENGTH, saved[d].name);
+      goto cleanup;
+    }
+  }
+
+  // nothing is spawned until the whole file checks out. pointers are fixed up in place on the way
+  size_t tables_offset = reader.offset;
+  uint64_t num_entities = 0;
+  _snapshot_layer = layer;
+  for(uint32_t t = 0; t < header->num_tables; t++) {
+    if(!_snapshot_next_table(&reader, directory, num_directory, &table)) {
+      goto truncated;
+    }
+    num_entities += table.count;
+    for(uint32_t c = 0; c < table.num_components; c++) {
+      const struct ComponentRegistration * component = table.components[c];
+      if(component->snapshot_pointers == NULL || component->size == 0) {
+        continue;
+      }
+      for(uint32_t r = 0; r < table.count; r++) {
+        component->snapshot_pointers(table.columns[c] + (size_t)component->size * r, (intptr_t)&_snapshot_anchor);
+      }
+    }
+  }
+  if(num_entities != header->num_entities) {
+    goto truncated;
+  }
+
+  Entity * entities = Engine_layer_alloc(layer, sizeof(*entities) * alias_max(num_entities, 1), alignof(*entities));
+  struct SnapshotLoadMap map = { .entities = entities, .num_entities = 0 };
+
+  reader.offset = tables_offset;
+  for(uint32_t t = 0; t < header->num_tables; t++) {
+    _snapshot_next_table(&reader, directory, num_directory, &table);
+
+    alias_ecs_EntitySpawnComponent spawn[SNAPSHOT_MAX_COMPONENTS];
+    for(uint32_t c = 0; c < table.num_components; c++) {
+      spawn[c] = (alias_ecs_EntitySpawnComponent) {
+          .component = *table.components[c]->handle
+        , .stride = table.components[c]->size
+        , .data = table.columns[c]
+        };
+    }
+
+    // a failure here leaves the tables spawned so far in the layer
+    if(alias_ecs_spawn(Engine_ecs(), &(alias_ecs_EntitySpawnInfo) {
+        .layer = layer
+      , .count = table.count
+      , .num_components = table.num_components
+      , .components = spawn
+      }, entities + map.num_entities) != ALIAS_ECS_SUCCESS) {
+      ALIAS_ERROR("could not spawn snapshot %s", path);
+      Engine_ecs_changed();
+      goto cleanup;
+    }
+    map.num_entities += table.count;
+  }
+
+  // entity references can only be mapped once everything is spawned, only components that hold entities are touched
+  reader.offset = tables_offset;
+  uint32_t first = 0;
+  for(uint32_t t = 0; t < header->num_tables; t++) {
+    _snapshot_next_table(&reader, directory, num_directory, &table);
+    for(uint32_t c = 0; c < table.num_components; c++) {
+      const struct ComponentRegistration * component = table.components[c];
+      if(component->snapshot_entities == NULL) {
+        continue;
+      }
+      for(uint32_t r = 0; r < table.count; r++) {
+        void * data;
+        if(alias_ecs_write_entity_component(Engine_ecs(), entities[first + r], *component->handle, &data) == ALIAS_ECS_SUCCESS) {
+          component->snapshot_entities(data, _snapshot_load_map, &map);
+        }
+      }
+    }
+    first += table.count;
+  }
+
+  Engine_ecs_changed();
+
+  if(num_entities_out != NULL) {
+    *num_entities_out = map.num_entities;
+  }
+  if(entities_out != NULL) {
+    *entities_out = entities;
+  }
+  result = true;
+  goto cleanup;
+
+truncated:
+  ALIAS_ERROR("snapshot %s is truncated", path);
+
+cleanup:
+  _snapshot_layer = ALIAS_ECS_INVALID_LAYER;
+  if(directory != NULL) {
+    alias_free(mcb, directory, sizeof(*directory) * alias_max(num_directory, 1), alignof(*directory));
+  }
+  alias_free(mcb, reader.data, file_size, SNAPSHOT_ALIGN);
+  return result;
+}
@@ -0,0 +1,185 @@
+#include "engine.h"
+
+#include <alias/log.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+
+// every thread that records owns a ring of events and is the only writer to it. the writer publishes the ring head
+// after filling a slot, a reader copies a window and then drops whatever the writer may have overwritten meanwhile.
+#define TRACE_EVENTS_PER_THREAD (64 * 1024)
+#define TRACE_THREAD_NAME_SIZE  32
+
+struct TraceEvent {
+  const char * name;
+  uint64_t start;
+  uint64_t duration;
+  uint64_t id;
+  char phase;
+};
+
+struct TraceThread {
+  struct TraceThread * next;
+  uint32_t tid;
+  char name[TRACE_THREAD_NAME_SIZE];
+  _Atomic uint64_t head;
+  struct TraceEvent events[TRACE_EVENTS_PER_THREAD];
+};
+
+static _Atomic(struct TraceThread *) _trace_threads = NULL;
+static _Atomic uint32_t _trace_next_tid = 1;
+static _Atomic uint64_t _trace_epoch = 0;
+static _Atomic bool _trace_enabled = false;
+static const char * _trace_exit_path = NULL;
+
+static _Thread_local struct TraceThread * _trace_thread = NULL;
+
+static struct TraceThread * _trace_thread_get(void) {
+  if(_trace_thread != NULL) {
+    return _trace_thread;
+  }
+
+  uint64_t zero = 0;
+  atomic_compare_exchange_strong(&_trace_epoch, &zero, uv_hrtime());
+
+  struct TraceThread * thread = alias_malloc(alias_default_MemoryCB(), sizeof(*thread), alignof(*thread));
+  thread->tid = atomic_fetch_add(&_trace_next_tid, 1);
+  snprintf(thread->name, sizeof(thread->name), "thread %u", thread->tid);
+  atomic_init(&thread->head, 0);
+
+  thread->next = atomic_load(&_trace_threads);
+  while(!atomic_compare_exchange_weak(&_trace_threads, &thread->next, thread)) ;
+
+  _trace_thread = thread;
+  return thread;
+}
+
+static void _trace_record(const char * name, char phase, uint64_t start, uint64_t duration, uint64_t id) {
+  if(!atomic_load_explicit(&_trace_enabled, memory_order_relaxed)) {
+    return;
+  }
+
+  struct TraceThread * thread = _trace_thread_get();
+  uint64_t head = atomic_load_explicit(&thread->head, memory_order_relaxed);
+
+  struct TraceEvent * event = &thread->events[head % TRACE_EVENTS_PER_THREAD];
+  event->name = name;
+  event->start = start;
+  event->duration = duration;
+  event->id = id;
+  event->phase = phase;
+
+  atomic_store_explicit(&thread->head, head + 1, memory_order_release);
+}
+
+void Engine_trace_thread_name(const char * name) {
+  struct TraceThread * thread = _trace_thread_get();
+  snprintf(thread->name, sizeof(thread->name), "%s", name);
+}
+
+// a zone begun while tracing was off keeps start 0 and is dropped, so an idle zone skips both clock reads
+struct TraceZone Engine_trace_begin(const char * name) {
+  if(!atomic_load_explicit(&_trace_enabled, memory_order_relaxed)) {
+    return (struct TraceZone) { .name = name, .start = 0 };
+  }
+  return (struct TraceZone) { .name = name, .start = uv_hrtime() };
+}
+
+void Engine_trace_end(struct TraceZone * zone) {
+  if(zone->start == 0) {
+    return;
+  }
+  uint64_t now = uv_hrtime();
+  _trace_record(zone->name, 'X', zone->start, now - zone->start, 0);
+}
+
+void Engine_trace_async_begin(const char * name, uint64_t id) {
+  _trace_record(name, 'b', uv_hrtime(), 0, id);
+}
+
+void Engine_trace_async_end(const char * name, uint64_t id) {
+  _trace_record(name, 'e', uv_hrtime(), 0, id);
+}
+
+bool Engine_trace_enabled(void) {
+  return atomic_load(&_trace_enabled);
+}
+
+void Engine_set_trace_enabled(bool enabled) {
+  atomic_store(&_trace_enabled, enabled);
+}
+
+static void _trace_write_string(FILE * file, const char * string) {
+  fputc('"', file);
+  for(; *string; string++) {
+    if(*string == '"' || *string == '\\') {
+      fputc('\\', file);
+    }
+    if((unsigned char)*string >= 0x20) {
+      fputc(*string, file);
+    }
+  }
+  fputc('"', file);
+}
+
+bool Engine_trace_write(const char * path) {
+  FILE * file = fopen(path, "w");
+  if(file == NULL) {
+    ALIAS_ERROR("could not open trace file %s", path);
+    return false;
+  }
+
+  struct TraceEvent * events = alias_malloc(alias_default_MemoryCB(), sizeof(*events) * TRACE_EVENTS_PER_THREAD, alignof(*events));
+  uint64_t epoch = atomic_load(&_trace_epoch);
+  bool first = true;
+
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+
+  for(struct TraceThread * thread = atomic_load(&_trace_threads); thread != NULL; thread = thread->next) {
+    fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", thread->tid);
+    _trace_write_string(file, thread->name);
+    fputs("}}", file);
+    first = false;
+
+    // copy a window, then keep only the part the writer cannot have lapped while we copied
+    uint64_t head = atomic_load_explicit(&thread->head, memory_order_acquire);
+    uint64_t tail = head > TRACE_EVENTS_PER_THREAD ? head - TRACE_EVENTS_PER_THREAD : 0;
+    for(uint64_t i = tail; i < head; i++) {
+      events[i - tail] = thread->events[i % TRACE_EVENTS_PER_THREAD];
+    }
+    uint64_t after = atomic_load_explicit(&thread->head, memory_order_acquire);
+    uint64_t valid = after > TRACE_EVENTS_PER_THREAD ? after - TRACE_EVENTS_PER_THREAD : 0;
+
+    for(uint64_t i = alias_max(tail, valid); i < head; i++) {
+      const struct TraceEvent * event = &events[i - tail];
+      double ts = (double)(int64_t)(event->start - epoch) / 1000.0;
+
+      fputs(",\n{\"name\":", file);
+      _trace_write_string(file, event->name);
+      if(event->phase == 'X') {
+        fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", thread->tid, ts, (double)event->duration / 1000.0);
+      } else {
+        fprintf(file, ",\"cat\":\"async\",\"ph\":\"%c\",\"id\":%llu,\"pid\":1,\"tid\":%u,\"ts\":%.3f}", event->phase, (unsigned long long)event->id, thread->tid, ts);
+      }
+    }
+  }
+
+  fputs("\n]}\n", file);
+  fclose(file);
+
+  alias_free(alias_default_MemoryCB(), events, sizeof(*events) * TRACE_EVENTS_PER_THREAD, alignof(*events));
+
+  return true;
+}
+
+void Engine_set_trace_exit_path(const char * path) {
+  _trace_exit_path = path;
+}
+
+// called from Engine_run after the loop stopped
+void Trace_cleanup(void) {
+  if(_trace_exit_path != NULL) {
+    Engine_trace_write(_trace_exit_path);
+  }
+}
@@ -5,6 +5,7 @@
 #include <alias/cpp.h>
 //#include <raylib.h>
 #include <assert.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <math.h>
 
@@ -12,6 +13,50 @@
 
 extern alias_ecs_Instance * Engine_ecs(void);
 
+// bumped on every structural change made through the engine: spawns, despawns, adding or removing components and
+// destroying layers. any of those can move components in storage, a resolved location is good until this changes.
+// it is one counter for the whole world, so any change anywhere drops every cache and the next read of each goes back
+// to the ecs. it only knows the engine paths: SPAWN*, CmdBuf execute, snapshot load and Engine_destroy_layer. code
+// that calls alias_ecs_spawn, _despawn, _add_component_to_entity or _remove_component_from_entity itself, and bundle
+// updates that change the layout of their own components, have to call Engine_ecs_changed() afterwards. debug builds
+// check every cache hit against the ecs to catch a missing call
+extern uint64_t _engine_ecs_generation;
+
+static inline uint64_t Engine_ecs_generation(void) {
+  return _engine_ecs_generation;
+}
+
+static inline void Engine_ecs_changed(void) {
+  _engine_ecs_generation++;
+}
+
+// a resolved component location for repeated lookups of the same entity, zero initialized is empty. only for reads,
+// writes have to go through the ecs every time so modified() filters see them
+struct ComponentCache {
+  Entity entity;
+  uint64_t generation;
+  const void * data;
+};
+
+static inline const void * ComponentCache_read(struct ComponentCache * cache, Entity entity, alias_ecs_ComponentHandle component) {
+  if(cache->generation != _engine_ecs_generation || cache->entity != entity) {
+    const void * data = NULL;
+    bool found = alias_ecs_read_entity_component(Engine_ecs(), entity, component, &data) == ALIAS_ECS_SUCCESS;
+    cache->entity = entity;
+    cache->generation = found ? _engine_ecs_generation : 0;
+    cache->data = found ? data : NULL;
+  }
+#ifndef NDEBUG
+  else {
+    // a hit that no longer matches the ecs means something changed the layout without Engine_ecs_changed()
+    const void * data = NULL;
+    alias_ecs_read_entity_component(Engine_ecs(), entity, component, &data);
+    assert(data == cache->data);
+  }
+#endif
+  return cache->data;
+}
+
 #define LAZY_GLOBAL(TYPE, IDENT, ...) \
   TYPE IDENT (void) {                 \
     static TYPE inner;                \
@@ -40,55 +85,108 @@ extern alias_ecs_Instance * Engine_ecs(void);
 
 #define DEFINE_FONT(IDENT, PATH) LAZY_GLOBAL_PTR(Font, IDENT, inner = LoadFont(PATH);)
 
-#define DECLARE_COMPONENT(IDENT, ...)                \
-  struct IDENT __VA_ARGS__;                          \
-  alias_ecs_ComponentHandle IDENT##_component(void); \
-  const struct IDENT * IDENT##_read(Entity entity);  \
+// components register in one pass inside Engine_init, their handles are plain globals from then on. each definition
+// adds itself to the registry before main runs. a component whose required components are not registered yet is
+// retried after the others
+struct ComponentRegistration {
+  struct ComponentRegistration * next;
+  const char * name;
+  bool (*try_register)(void);
+  alias_ecs_ComponentHandle * handle;
+  uint32_t size;
+
+  // see COMPONENT_SNAPSHOT
+  bool transient;
+  void (*snapshot_entities)(void * data, Entity (*map)(void * ud, Entity entity), void * ud);
+  void (*snapshot_pointers)(void * data, intptr_t slide);
+};
+
+extern void Engine_add_component_registration(struct ComponentRegistration * registration);
+extern bool Engine_try_register_component(const alias_ecs_ComponentCreateInfo * info, alias_ecs_ComponentHandle * handle);
+
+#define COMPONENT_REGISTRATION(IDENT, SIZE, ...)                                                    \
+  alias_ecs_ComponentHandle IDENT##_handle = ALIAS_ECS_INVALID_COMPONENT;                           \
+  static bool IDENT##_try_register(void) {                                                          \
+    return Engine_try_register_component(                                                           \
+      &(alias_ecs_ComponentCreateInfo) { .size = SIZE, ## __VA_ARGS__ }, &IDENT##_handle);          \
+  }                                                                                                 \
+  static struct ComponentRegistration IDENT##_registration = {                                      \
+    .name = #IDENT,                                                                                 \
+    .try_register = IDENT##_try_register,                                                           \
+    .handle = &IDENT##_handle,                                                                      \
+    .size = SIZE                                                                                    \
+  };                                                                                                \
+  __attribute__((constructor)) static void IDENT##_add_registration(void) {                         \
+    Engine_add_component_registration(&IDENT##_registration);                                       \
+  }
+
+// snapshots copy components byte for byte. ENTITIES maps every entity the component holds, on save to its place in
+// the snapshot and on load to the new entity. POINTERS adds slide to every pointer into static data, it runs on the
+// loaded bytes before they are spawned. either can be NULL. goes in the file with the component definition
+#define COMPONENT_SNAPSHOT(IDENT, ENTITIES, POINTERS)                                               \
+  __attribute__((constructor)) static void IDENT##_add_snapshot(void) {                             \
+    IDENT##_registration.snapshot_entities = ENTITIES;                                              \
+    IDENT##_registration.snapshot_pointers = POINTERS;                                              \
+  }
+
+// runtime only state, left out of snapshots
+#define COMPONENT_TRANSIENT(IDENT)                                                                  \
+  __attribute__((constructor)) static void IDENT##_add_transient(void) {                            \
+    IDENT##_registration.transient = true;                                                          \
+  }
+
+static inline const void * Snapshot_slide(const void * pointer, intptr_t slide) {
+  return pointer != NULL ? (const uint8_t *)pointer + slide : NULL;
+}
+
+// the layer a load spawns into while POINTERS runs on it, ALIAS_ECS_INVALID_LAYER on save. components that keep their
+// layer take this one
+extern alias_ecs_LayerHandle Snapshot_layer(void);
+
+#define DECLARE_COMPONENT(IDENT, ...)                                                 \
+  struct IDENT __VA_ARGS__;                                                           \
+  extern alias_ecs_ComponentHandle IDENT##_handle;                                    \
+  static inline alias_ecs_ComponentHandle IDENT##_component(void) {                   \
+    return IDENT##_handle;                                                            \
+  }                                                                                   \
+  static inline const struct IDENT * IDENT##_read_cached(                             \
+      struct ComponentCache * cache, Entity entity) {                                 \
+    return (const struct IDENT *)ComponentCache_read(cache, entity, IDENT##_handle);  \
+  }                                                                                   \
+  const struct IDENT * IDENT##_read(Entity entity);                                   \
   struct IDENT * IDENT##_write(Entity entity);
 
 #define DEFINE_COMPONENT(IDENT, ...)                                                                 \
-  LAZY_GLOBAL(                                                                                       \
-    alias_ecs_ComponentHandle,                                                                       \
-    IDENT##_component,                                                                               \
-    ECS(register_component, Engine_ecs()                                                             \
-      , &(alias_ecs_ComponentCreateInfo) { .size = sizeof(struct IDENT), ## __VA_ARGS__ }, &inner);  \
-  )                                                                                                  \
+  COMPONENT_REGISTRATION(IDENT, sizeof(struct IDENT), ## __VA_ARGS__)                                \
   const struct IDENT * IDENT##_read(Entity entity) {                                                 \
     const struct IDENT * ptr;                                                                        \
-    alias_ecs_read_entity_component(Engine_ecs(), entity, IDENT##_component(), (const void **)&ptr); \
+    alias_ecs_read_entity_component(Engine_ecs(), entity, IDENT##_handle, (const void **)&ptr);      \
     return ptr;                                                                                      \
   }                                                                                                  \
   struct IDENT * IDENT##_write(Entity entity) {                                                      \
     struct IDENT * ptr;                                                                              \
-    alias_ecs_write_entity_component(Engine_ecs(), entity, IDENT##_component(), (void **)&ptr);      \
+    alias_ecs_write_entity_component(Engine_ecs(), entity, IDENT##_handle, (void **)&ptr);           \
     return ptr;                                                                                      \
   }
 
-#define DECLARE_TAG_COMPONENT(IDENT) \
-  alias_ecs_ComponentHandle IDENT##_component(void);
+#define DECLARE_TAG_COMPONENT(IDENT)                                                  \
+  extern alias_ecs_ComponentHandle IDENT##_handle;                                    \
+  static inline alias_ecs_ComponentHandle IDENT##_component(void) {                   \
+    return IDENT##_handle;                                                            \
+  }
 
-#define DEFINE_TAG_COMPONENT(IDENT)                                                                \
-  LAZY_GLOBAL(                                                                                     \
-    alias_ecs_ComponentHandle,                                                                     \
-    IDENT##_component,                                                                             \
-    ECS(register_component, Engine_ecs(), &(alias_ecs_ComponentCreateInfo) { .size = 0 }, &inner); \
-  )
+#define DEFINE_TAG_COMPONENT(IDENT) COMPONENT_REGISTRATION(IDENT, 0)
 
 #define COMPONENT_impl(IDENT, ITYPE, DREF, ...)                                                      \
-  LAZY_GLOBAL(                                                                                       \
-    alias_ecs_ComponentHandle,                                                                       \
-    IDENT##_component,                                                                               \
-    ECS(register_component, Engine_ecs()                                                             \
-    , &(alias_ecs_ComponentCreateInfo) { .size = sizeof(ITYPE), ## __VA_ARGS__ }, &inner);           \
-  )                                                                                                  \
+  COMPONENT_REGISTRATION(IDENT, sizeof(ITYPE), ## __VA_ARGS__)                                       \
   const struct IDENT * IDENT##_read(Entity entity) {                                                 \
     const ITYPE * ptr;                                                                               \
-    alias_ecs_read_entity_component(Engine_ecs(), entity, IDENT##_component(), (const void **)&ptr); \
+    alias_ecs_read_entity_component(Engine_ecs(), entity, IDENT##_handle, (const void **)&ptr);      \
     return DREF ptr;                                                                                 \
   }                                                                                                  \
   struct IDENT * IDENT##_write(Entity entity) {                                                      \
     ITYPE * ptr;                                                                                     \
-    alias_ecs_write_entity_component(Engine_ecs(), entity, IDENT##_component(), (void **)&ptr);      \
+    alias_ecs_write_entity_component(Engine_ecs(), entity, IDENT##_handle, (void **)&ptr);           \
     return DREF ptr;                                                                                 \
   }
 
@@ -108,11 +206,38 @@ extern alias_ecs_Instance * Engine_ecs(void);
     .num_components = sizeof(_components) / sizeof(_components[0]), \
     .components = _components                                       \
   }, &_entity);                                                     \
+  Engine_ecs_changed();                                             \
   _entity;                                                          \
 })
 
 #define SPAWN(...) SPAWN_LAYER(ALIAS_ECS_INVALID_LAYER, ## __VA_ARGS__)
 
+// COUNT entities in one alias_ecs_spawn, their handles go to ENTITIES. every component is one of
+//   shared(TYPE, initializers...)    the same value for all entities
+//   each(TYPE, ARRAY)                ARRAY holds COUNT struct TYPE
+//   strided(TYPE, POINTER, STRIDE)   one struct TYPE every STRIDE bytes from POINTER
+// evaluates to the alias_ecs_Result of the spawn
+#define SPAWN_LAYER_N(LAYER, COUNT, ENTITIES, ...) ({                    \
+  alias_ecs_EntitySpawnComponent _components[] = {                       \
+    ALIAS_CPP_EVAL(ALIAS_CPP_MAP(SPAWN_N_COMPONENT, __VA_ARGS__))        \
+  };                                                                     \
+  alias_ecs_Result _result = alias_ecs_spawn(Engine_ecs(), &(alias_ecs_EntitySpawnInfo) { \
+    .layer = LAYER,                                                      \
+    .count = COUNT,                                                      \
+    .num_components = sizeof(_components) / sizeof(_components[0]),      \
+    .components = _components                                            \
+  }, ENTITIES);                                                          \
+  Engine_ecs_changed();                                                  \
+  _result;                                                               \
+})
+
+#define SPAWN_N(COUNT, ENTITIES, ...) SPAWN_LAYER_N(ALIAS_ECS_INVALID_LAYER, COUNT, ENTITIES, ## __VA_ARGS__)
+
+#define SPAWN_N_COMPONENT(X) ALIAS_CPP_CAT(SPAWN_N_COMPONENT_, X)
+#define SPAWN_N_COMPONENT_shared(TYPE, ...) { .component = TYPE##_component(), .stride = 0, .data = (void *)&(struct TYPE) { __VA_ARGS__ } },
+#define SPAWN_N_COMPONENT_each(TYPE, ARRAY) { .component = TYPE##_component(), .stride = sizeof(struct TYPE), .data = (const void *)(ARRAY) },
+#define SPAWN_N_COMPONENT_strided(TYPE, POINTER, STRIDE) { .component = TYPE##_component(), .stride = (STRIDE), .data = (const void *)(POINTER) },
+
 #if 0
 #define _QUERY_wlist(...)               _QUERY_wlist_ __VA_ARGS__               // unwrap
 #define _QUERY_wlist_(KIND, ...)        CAT(_QUERY_wlist_, KIND) (__VA_ARGS__) // add kind
@@ -226,6 +351,8 @@ extern alias_ecs_Instance * Engine_ecs(void);
 #define ALIAS_CPP_EQ__QUERYmodified_modified(...) ALIAS_CPP_PROBE
 #define ALIAS_CPP_EQ__QUERYaction_action(...)   ALIAS_CPP_PROBE
 #define ALIAS_CPP_EQ__QUERYpost_post(...)   ALIAS_CPP_PROBE
+#define ALIAS_CPP_EQ__QUERYrandom_read_random_read(...) ALIAS_CPP_PROBE
+#define ALIAS_CPP_EQ__QUERYrandom_write_random_write(...) ALIAS_CPP_PROBE
 
 #define QUERY_is_state(X) ALIAS_CPP_EQ(QUERY, state, X)
 #define QUERY_is_pre(X) ALIAS_CPP_EQ(QUERY, pre, X)
@@ -234,6 +361,8 @@ extern alias_ecs_Instance * Engine_ecs(void);
 #define QUERY_is_filter(X) ALIAS_CPP_OR(ALIAS_CPP_OR(ALIAS_CPP_EQ(QUERY, optional, X), ALIAS_CPP_EQ(QUERY, exclude, X)), ALIAS_CPP_EQ(QUERY, modified, X))
 #define QUERY_is_action(X) ALIAS_CPP_EQ(QUERY, action, X)
 #define QUERY_is_post(X) ALIAS_CPP_EQ(QUERY, post, X)
+#define QUERY_is_random_read(X) ALIAS_CPP_EQ(QUERY, random_read, X)
+#define QUERY_is_random_write(X) ALIAS_CPP_EQ(QUERY, random_write, X)
 
 #define QUERY_emit(X) ALIAS_CPP_CAT(QUERY_emit_, X)
 #define QUERY_emit_state(TYPE, NAME, ...) TYPE NAME;
@@ -249,6 +378,19 @@ extern alias_ecs_Instance * Engine_ecs(void);
 #define QUERY_emit_create_optional(TYPE) { .component = TYPE##_component(), .filter = ALIAS_ECS_FILTER_OPTIONAL },
 #define QUERY_emit_create_exclude(TYPE) { .component = TYPE##_component(), .filter = ALIAS_ECS_FILTER_EXCLUDE },
 #define QUERY_emit_create_modified(TYPE) { .component = TYPE##_component(), .filter = ALIAS_ECS_FILTER_MODIFIED },
+#define QUERY_emit_create_random_read(TYPE) TYPE##_component(),
+#define QUERY_emit_create_random_write(TYPE) TYPE##_component(),
+
+// the components a system touches, used by the scheduler to order systems. random_read(TYPE) and random_write(TYPE)
+// declare access made from the action through TYPE_read/TYPE_write on other entities
+#define MAX_SYSTEM_ACCESS 32
+
+struct SystemAccess {
+  uint32_t num_read;
+  uint32_t num_write;
+  alias_ecs_ComponentHandle read[MAX_SYSTEM_ACCESS];
+  alias_ecs_ComponentHandle write[MAX_SYSTEM_ACCESS];
+};
 
 #define QUERY(NAME, ...) ALIAS_CPP_EVAL(QUERY_impl(NAME, __VA_ARGS__))
 #define QUERY_impl(NAME, ...) \
@@ -256,16 +398,139 @@ extern alias_ecs_Instance * Engine_ecs(void);
     alias_ecs_Query * query; \
     ALIAS_CPP_FILTER_MAP(QUERY_is_state, QUERY_emit, __VA_ARGS__) \
   }; \
+  QUERY_emit_do(NAME, __VA_ARGS__) \
+  void NAME(void) { \
+    static struct ALIAS_CPP_CAT(NAME, _state) _state = { 0 }; \
+    static struct ALIAS_CPP_CAT(NAME, _state) * state = &_state; \
+    TRACE_ZONE(#NAME); \
+    QUERY_emit_create_query(__VA_ARGS__) \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_pre, QUERY_emit, __VA_ARGS__) \
+    alias_ecs_execute_query(Engine_ecs(), state->query, (alias_ecs_QueryCB) { ALIAS_CPP_CAT(NAME, _do), state }); \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_post, QUERY_emit, __VA_ARGS__) \
+  } \
+  QUERY_emit_access(NAME, __VA_ARGS__)
+
+// the action runs on the workers over chunks of the matching entities. every chunk gets its own copy of state(), taken
+// after pre(). post() sees the copies as states[0 .. num_states - 1] and reduces them into state. the action must not
+// touch anything outside its entity and its state copy
+#define QUERY_PARALLEL(NAME, ...) ALIAS_CPP_EVAL(QUERY_PARALLEL_impl(NAME, __VA_ARGS__))
+#define QUERY_PARALLEL_impl(NAME, ...) \
+  struct ALIAS_CPP_CAT(NAME, _state) { \
+    alias_ecs_Query * query; \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_state, QUERY_emit, __VA_ARGS__) \
+  }; \
+  QUERY_emit_do(NAME, __VA_ARGS__) \
+  void NAME(void) { \
+    static struct ALIAS_CPP_CAT(NAME, _state) _state = { 0 }; \
+    static struct ALIAS_CPP_CAT(NAME, _state) * state = &_state; \
+    TRACE_ZONE(#NAME); \
+    static struct QueryParallel _parallel = { 0 }; \
+    QUERY_emit_create_query(__VA_ARGS__) \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_pre, QUERY_emit, __VA_ARGS__) \
+    alias_ecs_ComponentHandle _dlist[] = { \
+      ALIAS_CPP_FILTER_MAP(QUERY_is_write, QUERY_emit_create, __VA_ARGS__) \
+      ALIAS_CPP_FILTER_MAP(QUERY_is_read, QUERY_emit_create, __VA_ARGS__) \
+    }; \
+    _parallel.num_data = sizeof(_dlist) / sizeof(_dlist[0]); \
+    QueryParallel_execute(&_parallel, state->query, state, sizeof(*state), ALIAS_CPP_CAT(NAME, _do)); \
+    struct ALIAS_CPP_CAT(NAME, _state) * states = (struct ALIAS_CPP_CAT(NAME, _state) *)_parallel.states; \
+    uint32_t num_states = _parallel.num_chunks; \
+    (void)states; \
+    (void)num_states; \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_post, QUERY_emit, __VA_ARGS__) \
+  } \
+  QUERY_emit_access(NAME, __VA_ARGS__)
+
+// the action runs once per run of entities whose components sit next to each other in the ecs storage, with count,
+// entities[count] and every read/write name as a restrict array of count components. a run never mixes entities with
+// and without an optional component, a missing component ends the run of present ones and the other way round. so an
+// optional name is either NULL for the whole run or valid for all count entities
+#define QUERY_CHUNK(NAME, ...) ALIAS_CPP_EVAL(QUERY_CHUNK_impl(NAME, __VA_ARGS__))
+#define QUERY_CHUNK_impl(NAME, ...) \
+  struct ALIAS_CPP_CAT(NAME, _state) { \
+    alias_ecs_Query * query; \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_state, QUERY_emit, __VA_ARGS__) \
+  }; \
+  QUERY_emit_chunk_do(NAME, __VA_ARGS__) \
+  void NAME(void) { \
+    static struct ALIAS_CPP_CAT(NAME, _state) _state = { 0 }; \
+    static struct ALIAS_CPP_CAT(NAME, _state) * state = &_state; \
+    static struct QueryChunk _chunk = { 0 }; \
+    TRACE_ZONE(#NAME); \
+    QUERY_emit_create_query(__VA_ARGS__) \
+    QUERY_emit_sizes(__VA_ARGS__) \
+    _chunk.num_data = sizeof(_sizes) / sizeof(_sizes[0]); \
+    _chunk.sizes = _sizes; \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_pre, QUERY_emit, __VA_ARGS__) \
+    QueryChunk_execute(&_chunk, state->query, state, ALIAS_CPP_CAT(NAME, _do)); \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_post, QUERY_emit, __VA_ARGS__) \
+  } \
+  QUERY_emit_access(NAME, __VA_ARGS__)
+
+// QUERY_CHUNK over the workers, runs never cross a worker chunk. state() works as in QUERY_PARALLEL
+#define QUERY_PARALLEL_CHUNK(NAME, ...) ALIAS_CPP_EVAL(QUERY_PARALLEL_CHUNK_impl(NAME, __VA_ARGS__))
+#define QUERY_PARALLEL_CHUNK_impl(NAME, ...) \
+  struct ALIAS_CPP_CAT(NAME, _state) { \
+    alias_ecs_Query * query; \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_state, QUERY_emit, __VA_ARGS__) \
+  }; \
+  QUERY_emit_chunk_do(NAME, __VA_ARGS__) \
+  void NAME(void) { \
+    static struct ALIAS_CPP_CAT(NAME, _state) _state = { 0 }; \
+    static struct ALIAS_CPP_CAT(NAME, _state) * state = &_state; \
+    TRACE_ZONE(#NAME); \
+    static struct QueryParallel _parallel = { 0 }; \
+    QUERY_emit_create_query(__VA_ARGS__) \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_pre, QUERY_emit, __VA_ARGS__) \
+    QUERY_emit_sizes(__VA_ARGS__) \
+    _parallel.num_data = sizeof(_sizes) / sizeof(_sizes[0]); \
+    _parallel.sizes = _sizes; \
+    QueryParallel_execute_chunks(&_parallel, state->query, state, sizeof(*state), ALIAS_CPP_CAT(NAME, _do)); \
+    struct ALIAS_CPP_CAT(NAME, _state) * states = (struct ALIAS_CPP_CAT(NAME, _state) *)_parallel.states; \
+    uint32_t num_states = _parallel.num_chunks; \
+    (void)states; \
+    (void)num_states; \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_post, QUERY_emit, __VA_ARGS__) \
+  } \
+  QUERY_emit_access(NAME, __VA_ARGS__)
+
+#define QUERY_emit_chunk_do(NAME, ...) \
+  static void ALIAS_CPP_CAT(NAME, _do)(void * ud, uint32_t count, const alias_ecs_EntityHandle * restrict entities, void ** data) { \
+    uint32_t __i = 0; \
+    struct ALIAS_CPP_CAT(NAME, _state) * state = (struct ALIAS_CPP_CAT(NAME, _state) *)ud; \
+    (void)state; \
+    (void)count; \
+    (void)entities; \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_write, QUERY_emit_chunk, __VA_ARGS__) \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_read, QUERY_emit_chunk, __VA_ARGS__) \
+    ALIAS_CPP_FILTER_MAP(QUERY_is_action, QUERY_emit, __VA_ARGS__) \
+  }
+
+#define QUERY_emit_sizes(...) \
+    static const uint32_t _sizes[] = { \
+      ALIAS_CPP_FILTER_MAP(QUERY_is_write, QUERY_emit_size, __VA_ARGS__) \
+      ALIAS_CPP_FILTER_MAP(QUERY_is_read, QUERY_emit_size, __VA_ARGS__) \
+    };
+
+#define QUERY_emit_chunk(X) ALIAS_CPP_CAT(QUERY_emit_chunk_, X)
+#define QUERY_emit_chunk_write(TYPE, NAME) struct TYPE * restrict NAME = (struct TYPE *)data[__i++];
+#define QUERY_emit_chunk_read(TYPE, NAME) const struct TYPE * restrict NAME = (const struct TYPE *)data[__i++];
+
+#define QUERY_emit_size(X) ALIAS_CPP_CAT(QUERY_emit_size_, X)
+#define QUERY_emit_size_write(TYPE, NAME) sizeof(struct TYPE),
+#define QUERY_emit_size_read(TYPE, NAME) sizeof(struct TYPE),
+
+#define QUERY_emit_do(NAME, ...) \
   static void ALIAS_CPP_CAT(NAME, _do)(void * ud, alias_ecs_Instance * instance, alias_ecs_EntityHandle entity, void ** data) { \
     uint32_t __i = 0; \
     struct ALIAS_CPP_CAT(NAME, _state) * state = (struct ALIAS_CPP_CAT(NAME, _state) *)ud; \
+    (void)state; \
     ALIAS_CPP_FILTER_MAP(QUERY_is_write, QUERY_emit, __VA_ARGS__) \
     ALIAS_CPP_FILTER_MAP(QUERY_is_read, QUERY_emit, __VA_ARGS__) \
     ALIAS_CPP_FILTER_MAP(QUERY_is_action, QUERY_emit, __VA_ARGS__) \
-  } \
-  void NAME(void) { \
-    static struct ALIAS_CPP_CAT(NAME, _state) _state = { 0 }; \
-    static struct ALIAS_CPP_CAT(NAME, _state) * state = &_state; \
+  }
+
+#define QUERY_emit_create_query(...) \
     if(state->query == NULL) { \
       alias_ecs_ComponentHandle _rlist[] = { ALIAS_CPP_FILTER_MAP(QUERY_is_read, QUERY_emit_create, __VA_ARGS__) }; \
       alias_ecs_ComponentHandle _wlist[] = { ALIAS_CPP_FILTER_MAP(QUERY_is_write, QUERY_emit_create, __VA_ARGS__) }; \
@@ -278,34 +543,175 @@ extern alias_ecs_Instance * Engine_ecs(void);
         .num_filters = sizeof(_flist) / sizeof(_flist[0]), \
         .filters = _flist \
       }, &state->query); \
-    } \
-    ALIAS_CPP_FILTER_MAP(QUERY_is_pre, QUERY_emit, __VA_ARGS__) \
-    alias_ecs_execute_query(Engine_ecs(), state->query, (alias_ecs_QueryCB) { ALIAS_CPP_CAT(NAME, _do), state }); \
-    ALIAS_CPP_FILTER_MAP(QUERY_is_post, QUERY_emit, __VA_ARGS__) \
+    }
+
+#define QUERY_emit_access(NAME, ...) \
+  void ALIAS_CPP_CAT(NAME, _access)(struct SystemAccess * access) { \
+    alias_ecs_ComponentHandle _rlist[] = { \
+      ALIAS_CPP_FILTER_MAP(QUERY_is_read, QUERY_emit_create, __VA_ARGS__) \
+      ALIAS_CPP_FILTER_MAP(QUERY_is_random_read, QUERY_emit_create, __VA_ARGS__) \
+    }; \
+    alias_ecs_ComponentHandle _wlist[] = { \
+      ALIAS_CPP_FILTER_MAP(QUERY_is_write, QUERY_emit_create, __VA_ARGS__) \
+      ALIAS_CPP_FILTER_MAP(QUERY_is_random_write, QUERY_emit_create, __VA_ARGS__) \
+    }; \
+    access->num_read = sizeof(_rlist) / sizeof(_rlist[0]); \
+    access->num_write = sizeof(_wlist) / sizeof(_wlist[0]); \
+    assert(access->num_read <= MAX_SYSTEM_ACCESS && access->num_write <= MAX_SYSTEM_ACCESS); \
+    for(uint32_t __i = 0; __i < access->num_read; __i++) access->read[__i] = _rlist[__i]; \
+    for(uint32_t __i = 0; __i < access->num_write; __i++) access->write[__i] = _wlist[__i]; \
   }
 
+// matching rows are gathered on the calling thread, alias_ecs only iterates through a callback, then split into chunks
+// the scratch grows to the largest match and is kept between frames, Query_cleanup frees it at shutdown
+struct QueryParallel {
+  struct QueryParallel * next;
+  uint32_t num_data;
+  const uint32_t * sizes; // for QueryParallel_execute_chunks
+  uint32_t num_rows;
+  uint32_t capacity;
+  alias_ecs_EntityHandle * entities;
+  void ** data;
+
+  uint32_t num_chunks;
+  uint32_t states_capacity;
+  size_t state_size;
+  void * states;
+};
+
+// runs are found by checking that every component pointer follows the previous one by its size
+struct QueryChunk {
+  struct QueryChunk * next;
+  uint32_t num_data;
+  const uint32_t * sizes;
+
+  uint32_t count;
+  uint32_t capacity;
+  alias_ecs_EntityHandle * entities;
+  void * data[MAX_SYSTEM_ACCESS];
+
+  void * ud;
+  void (*action)(void * ud, uint32_t count, const alias_ecs_EntityHandle * entities, void ** data);
+};
+
+void QueryChunk_execute(struct QueryChunk * chunk, alias_ecs_Query * query, void * ud, void (*action)(void * ud, uint32_t count, const alias_ecs_EntityHandle * entities, void ** data));
+
+void QueryParallel_execute(struct QueryParallel * parallel, alias_ecs_Query * query, const void * state, size_t state_size, void (*action)(void * ud, alias_ecs_Instance * instance, alias_ecs_EntityHandle entity, void ** data));
+void QueryParallel_execute_chunks(struct QueryParallel * parallel, alias_ecs_Query * query, const void * state, size_t state_size, void (*action)(void * ud, uint32_t count, const alias_ecs_EntityHandle * entities, void ** data));
+
+// bump allocator over a chain of blocks. nothing is freed on its own, Arena_reset rewinds and keeps the blocks for
+// reuse, Arena_free releases them
+struct ArenaBlock;
+
+struct Arena {
+  struct ArenaBlock * blocks;
+  struct ArenaBlock * current;
+  size_t block_size; // 0 picks ARENA_DEFAULT_BLOCK_SIZE
+};
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+void * Arena_alloc(struct Arena * arena, size_t size, size_t align);
+void Arena_reset(struct Arena * arena);
+void Arena_free(struct Arena * arena);
+
+// commands are kept 16 aligned so the data after a struct Cmd is as well
 struct Cmd {
-  uint32_t size;
+  _Alignas(16) uint32_t size;
   enum {
     cmd_add_component,
     cmd_remove_component,
-    cmd_despawn
+    cmd_despawn,
+    cmd_spawn,
+    cmd_publish
   } tag;
   alias_ecs_EntityHandle entity;
   alias_ecs_ComponentHandle component;
+  uint32_t data_size; // add only, the bytes after the command
 };
 
+// buffers record into fixed size pages, a command bigger than a page gets a page of its own. pages are never moved
+// or freed, a new recording starts over in the first one so a buffer stops allocating once it has seen its busiest
+// frame
+#define CMD_PAGE_SIZE (16 * 1024)
+
+struct CmdPage;
+
 struct CmdBuf {
-  void * start;
-  void * pointer;
-  void * end;
+  struct CmdPage * pages;
+  struct CmdPage * current;
+  uint32_t id; // in its placeholders, given by the first spawn
+  uint32_t num_spawns;
+  uint32_t num_publishes;
+  uint32_t num_commands;
+  size_t size;
 };
 
+// over every buffer since startup. high water marks are the most one buffer held at once
+struct CmdBufStats {
+  uint64_t pages;
+  uint64_t page_bytes;
+  uint64_t high_water_bytes;
+  uint64_t high_water_commands;
+};
+
+struct CmdBufStats CmdBuf_stats(void);
+
+// CmdBuf_spawn hands out placeholders, later commands in the same buffer can use them like entities. component data is
+// copied as is, so a placeholder inside component data is not resolved. a placeholder is the top bit, the id of the
+// buffer that spawned it in bits 32 to 62 and the spawn ordinal in that buffer below. using it in another buffer,
+// another buffer of the same stream included, asserts and the command is dropped
+#define CMD_PLACEHOLDER_BIT      ((alias_ecs_EntityHandle)1 << 63)
+#define CMD_PLACEHOLDER_ID_SHIFT 32
+#define CMD_PLACEHOLDER_MAX_ID   0x7ffffffe // all ones would be ALIAS_ECS_INVALID_ENTITY
+
+_Static_assert(sizeof(alias_ecs_EntityHandle) == 8, "placeholders need a 64 bit entity handle");
+
+static inline bool CmdBuf_is_placeholder(alias_ecs_EntityHandle entity) {
+  return (entity & CMD_PLACEHOLDER_BIT) && entity != ALIAS_ECS_INVALID_ENTITY;
+}
+
 void CmdBuf_add_component(struct CmdBuf * cbuf, alias_ecs_EntityHandle entity, alias_ecs_ComponentHandle component, void * data, size_t data_size);
 void CmdBuf_remove_component(struct CmdBuf * cbuf, alias_ecs_EntityHandle entity, alias_ecs_ComponentHandle component);
 void CmdBuf_despawn(struct CmdBuf * cbuf, alias_ecs_EntityHandle entity);
+
+// room for one event of channel, appended to the channel when the buffer executes
+struct EventChannel;
+void * CmdBuf_publish(struct CmdBuf * cbuf, struct EventChannel * channel);
+alias_ecs_EntityHandle CmdBuf_spawn(struct CmdBuf * cbuf, alias_ecs_LayerHandle layer, uint32_t num_components, const alias_ecs_EntitySpawnComponent * components);
 void CmdBuf_begin_recording(struct CmdBuf * cbuf);
 void CmdBuf_end_recording(struct CmdBuf * cbuf);
 void CmdBuf_execute(struct CmdBuf * cbuf, alias_ecs_Instance * instance);
 
+// SPAWN_LAYER recorded into CBUF, evaluates to the placeholder
+#define CMD_SPAWN_LAYER(CBUF, LAYER, ...) ({                                                         \
+  alias_ecs_EntitySpawnComponent _components[] = {                                                   \
+    ALIAS_CPP_EVAL(ALIAS_CPP_MAP(SPAWN_COMPONENT, __VA_ARGS__))                                      \
+  };                                                                                                 \
+  CmdBuf_spawn(CBUF, LAYER, sizeof(_components) / sizeof(_components[0]), _components);              \
+})
+
+#define CMD_SPAWN(CBUF, ...) CMD_SPAWN_LAYER(CBUF, ALIAS_ECS_INVALID_LAYER, ## __VA_ARGS__)
+
+// systems record structural changes into the buffer of the system and query chunk they run in. at the end of
+// Engine_run_systems every buffer is applied by system, then by chunk, then in recording order. chunks split the rows
+// in order, so that is the order a serial run records in no matter how many workers took part. the loop thread has
+// its own buffer outside of systems, applied at the same sync points after the systems. a chunk must not run another
+// parallel query. a job that is not part of a system has no buffer and must not call this
+struct CmdBuf * Engine_cmd_buf(void);
+
+// the buffers of one system, in the order they are applied. buffers are allocated one by one so a pointer to one
+// stays good while another thread grows the list
+struct CmdStream {
+  uint32_t length;
+  uint32_t capacity;
+  struct CmdBuf ** bufs;
+};
+
+// where the calling thread records
+struct CmdScope {
+  struct CmdStream * stream;
+  uint32_t index;
+};
+
 #endif // _UTIL_H_
@@ -1,5 +1,7 @@
 #include "state/local.h"
 
+#include <stdlib.h>
+
 #define SCREEN_WIDTH  800
 #define SCREEN_HEIGHT 600
 
@@ -19,6 +21,7 @@ struct InputBackendPair main_input_backend[] = {
   { Keyboard_D, Binding_PlayerRight },
   { Keyboard_W, Binding_PlayerUp },
   { Keyboard_S, Binding_PlayerDown },
+  { Keyboard_F3, Binding_Profile },
 };
 
 struct MainInputs main_inputs = {
@@ -30,6 +33,7 @@ struct MainInputs main_inputs = {
   , .menu_forward = INPUT_SIGNAL_UP(Binding_Forward)
   , .mouse_position = INPUT_SIGNAL_POINT(Binding_MouseX, Binding_MouseY)
   , .mouse_left_click = INPUT_SIGNAL_DOWN(Binding_LeftClick)
+  , .profile = INPUT_SIGNAL_UP(Binding_Profile)
   };
 
 extern struct State intro_state;
@@ -39,7 +43,18 @@ int main(void) {
 
   Engine_set_player_input_backend(0, sizeof(main_input_backend) / sizeof(main_input_backend[0]), main_input_backend);
 
-  Engine_add_input_frontend(0, 8, &main_inputs.menu_up);
+  Engine_add_input_frontend(0, 9, &main_inputs.menu_up);
+
+  Engine_set_trace_enabled(getenv("ALIAS_TOWN_TRACE") != NULL);
+  Engine_set_trace_exit_path(getenv("ALIAS_TOWN_TRACE"));
+
+  Engine_set_pipelined_rendering(getenv("ALIAS_TOWN_SERIAL_RENDERING") == NULL);
+
+  if(getenv("ALIAS_TOWN_REPLAY") != NULL) {
+    Engine_replay_input(getenv("ALIAS_TOWN_REPLAY"));
+  } else if(getenv("ALIAS_TOWN_RECORD") != NULL) {
+    Engine_record_input(getenv("ALIAS_TOWN_RECORD"));
+  }
 
   Engine_run();
 }
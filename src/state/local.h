@@ -15,6 +15,7 @@ enum Binding {
   Binding_PlayerRight,
   Binding_PlayerUp,
   Binding_PlayerDown,
+  Binding_Profile,
 };
 
 struct MainInputs {
@@ -26,6 +27,7 @@ struct MainInputs {
   struct InputSignal menu_forward;
   struct InputSignal mouse_position;
   struct InputSignal mouse_left_click;
+  struct InputSignal profile;
 };
 
 extern struct MainInputs main_inputs;
@@ -4,15 +4,8 @@
 
 #include "local.h"
 
-// system
-extern void player_movement_system(void);
-extern void movement_system(void);
-extern void armor_system(void);
-extern void shield_system(void);
-extern void power_system(void);
-
 // prefab
-extern alias_ecs_EntityHandle _spawn_grass(alias_ecs_LayerHandle layer, alias_pga2d_Point origin);
+extern alias_ecs_Result _spawn_grass(alias_ecs_LayerHandle layer, uint32_t count, const struct alias_Translation2D * translations, alias_ecs_EntityHandle * entities);
 extern alias_ecs_EntityHandle _spawn_target(alias_ecs_LayerHandle layer);
 extern alias_ecs_EntityHandle _spawn_player(alias_ecs_LayerHandle layer, alias_pga2d_Point origin, alias_ecs_EntityHandle target);
 extern alias_ecs_EntityHandle _spawn_camera(alias_ecs_LayerHandle layer, alias_ecs_EntityHandle target);
@@ -35,14 +28,31 @@ struct {
 //   - (de)spawn certain enemys in a pattern
 // - 
 
+#define LEVEL_GRASS 1000
+
+// ALIAS_TOWN_LEVEL loads the level from a snapshot, ALIAS_TOWN_SAVE_LEVEL saves the generated one
 void _load_level(void) {
+  const char * level = getenv("ALIAS_TOWN_LEVEL");
+  if(level != NULL && Engine_snapshot_load(level, _playing.level_layer, NULL, NULL)) {
+    return;
+  }
+
   // make some grass
-  for(uint32_t i = 0; i < 1000; i++) {
+  struct alias_Translation2D * grass = alias_malloc(alias_default_MemoryCB(), sizeof(*grass) * LEVEL_GRASS, alignof(*grass));
+  alias_ecs_EntityHandle * entities = alias_malloc(alias_default_MemoryCB(), sizeof(*entities) * LEVEL_GRASS, alignof(*entities));
+  for(uint32_t i = 0; i < LEVEL_GRASS; i++) {
     alias_R x = alias_random_f32_snorm() * 100;
     alias_R y = alias_random_f32_snorm() * 100;
 
-    _spawn_grass(_playing.level_layer, alias_pga2d_point(x, y));
+    alias_memory_clear(&grass[i], sizeof(grass[i]));
+    grass[i].value = alias_pga2d_point(x, y);
+    grass[i].value.e12 = alias_R_ZERO;
+  }
+  if(_spawn_grass(_playing.level_layer, LEVEL_GRASS, grass, entities) == ALIAS_ECS_SUCCESS && getenv("ALIAS_TOWN_SAVE_LEVEL") != NULL) {
+    Engine_snapshot_save(getenv("ALIAS_TOWN_SAVE_LEVEL"), LEVEL_GRASS, entities);
   }
+  alias_free(alias_default_MemoryCB(), grass, sizeof(*grass) * LEVEL_GRASS, alignof(*grass));
+  alias_free(alias_default_MemoryCB(), entities, sizeof(*entities) * LEVEL_GRASS, alignof(*entities));
 }
 
 void _playing_begin(void * ud) {
@@ -50,29 +60,32 @@ void _playing_begin(void * ud) {
 
   Engine_physics_2d_bundle()->gravity = (alias_pga2d_Direction) { .e02 = 9.81 };
 
-  alias_ecs_create_layer(Engine_ecs(), &(alias_ecs_LayerCreateInfo) {
-    .max_entities = 0
-  }, &_playing.player_layer);
+  _playing.player_layer = Engine_create_layer(0);
 
   _playing.target = _spawn_target(_playing.player_layer);
   _playing.player = _spawn_player(_playing.player_layer, alias_pga2d_point(0, 0), _playing.target);
   _playing.camera = _spawn_camera(_playing.player_layer, _playing.player);
   PlayerControlMovement_write(_playing.player)->inputs->mouse_position.click_camera = _playing.camera;
 
-  alias_ecs_create_layer(Engine_ecs(), &(alias_ecs_LayerCreateInfo) {
-    .max_entities = 0
-  }, &_playing.level_layer);
+  _playing.level_layer = Engine_create_layer(0);
 
   _load_level();
 }
 
+static const struct System _playing_systems[] = {
+    SYSTEM(player_movement_system)
+  , SYSTEM(movement_system)
+  , SYSTEM(armor_system)
+  , SYSTEM(shield_system)
+  , SYSTEM(power_system)
+};
+
 void _playing_frame(void * ud) {
   (void)ud;
-  player_movement_system();
-  movement_system();
-  armor_system();
-  shield_system();
-  power_system();
+
+  if(main_inputs.profile.boolean) {
+    Engine_set_profile_overlay(!Engine_profile_overlay());
+  }
 
   Engine_ui_bottom_left();
   Engine_ui_vertical(); {
@@ -99,11 +112,13 @@ void _playing_frame(void * ud) {
 void _playing_end(void * ud) {
   (void)ud;
 
-  alias_ecs_destroy_layer(Engine_ecs(), _playing.player_layer, ALIAS_ECS_LAYER_DESTROY_REMOVE_ENTITIES);
-  alias_ecs_destroy_layer(Engine_ecs(), _playing.level_layer, ALIAS_ECS_LAYER_DESTROY_REMOVE_ENTITIES);
+  Engine_destroy_layer(_playing.player_layer);
+  Engine_destroy_layer(_playing.level_layer);
 }
 
 struct State playing_state = {
+  .num_systems = sizeof(_playing_systems) / sizeof(_playing_systems[0]),
+  .systems = _playing_systems,
   .begin = _playing_begin,
   .frame = _playing_frame,
   .end   = _playing_end
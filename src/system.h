@@ -1,3 +1,9 @@
 #pragma once
 
 #include "component.h"
+
+DECLARE_SYSTEM(player_movement_system)
+DECLARE_SYSTEM(movement_system)
+DECLARE_SYSTEM(armor_system)
+DECLARE_SYSTEM(shield_system)
+DECLARE_SYSTEM(power_system)
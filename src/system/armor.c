@@ -1,11 +1,13 @@
 #include "../component.h"
 
-QUERY( armor_system
+QUERY_PARALLEL_CHUNK( armor_system
   , write(Armor, armor)
   , action(
-    alias_R max = GameValue_get(&armor->max);
-    alias_R delta = GameValue_get(&armor->regen_per_second) + max * GameValue_get(&armor->regen_percent_per_second);
-    LiveValue_update(&armor->live, delta, max);
+    alias_R frame_time = Engine_frame_time(), time = Engine_time();
+    for(uint32_t i = 0; i < count; i++) {
+      alias_R max = GameValue_get(&armor[i].max);
+      alias_R delta = GameValue_get(&armor[i].regen_per_second) + max * GameValue_get(&armor[i].regen_percent_per_second);
+      LiveValue_update_at(&armor[i].live, delta, max, frame_time, time);
+    }
   )
 )
-
@@ -30,7 +30,7 @@ QUERY( movement_system
       if(move->target == MovementTarget_Point) {
         Tw = move->target_point;
       } else {
-        const alias_LocalToWorld2D * tgt = alias_LocalToWorld2D_read(move->target_entity);
+        const alias_LocalToWorld2D * tgt = alias_LocalToWorld2D_read_cached(&move->target_cache, move->target_entity);
         if(tgt == NULL) {
           move->done = true;
         } else {
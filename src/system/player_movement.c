@@ -1,8 +1,9 @@
 #include "../component.h"
 
-QUERY( _player_control_movement
+QUERY( player_movement_system
   , write(Movement, move)
   , write(PlayerControlMovement, controller)
+  , random_write(alias_Translation2D)
   , action(
     alias_R
       right_left = controller->inputs->right.boolean - controller->inputs->left.boolean,
@@ -34,7 +35,3 @@ QUERY( _player_control_movement
     }
   )
 )
-
-void player_movement_system(void) {
-  _player_control_movement();
-}
@@ -1,16 +1,18 @@
 #include "../component.h"
 
-QUERY( power_system
+QUERY_PARALLEL_CHUNK( power_system
   , write(Power, power)
   , read(Shield, shield)
   , optional(Shield)
   , action(
-    alias_R max = GameValue_get(&power->max);
-    alias_R delta = GameValue_get(&power->generation_per_second);
-    if(shield && shield->recharging) {
-      delta -= GameValue_get(&shield->recharge_power_per_second);
+    alias_R frame_time = Engine_frame_time(), time = Engine_time();
+    for(uint32_t i = 0; i < count; i++) {
+      alias_R max = GameValue_get(&power[i].max);
+      alias_R delta = GameValue_get(&power[i].generation_per_second);
+      if(shield && shield[i].recharging) {
+        delta -= GameValue_get(&shield[i].recharge_power_per_second);
+      }
+      LiveValue_update_at(&power[i].live, delta, max, frame_time, time);
     }
-    LiveValue_update(&power->live, delta, max);
   )
 )
-
@@ -1,20 +1,23 @@
 #include "../component.h"
 
-QUERY( shield_system
+QUERY_PARALLEL_CHUNK( shield_system
   , write(Shield, shield)
   , action(
-    alias_R max = GameValue_get(&shield->max);
-    alias_R delta = GameValue_get(&shield->regen_per_second) + max * GameValue_get(&shield->regen_percent_per_second);
+    alias_R frame_time = Engine_frame_time(), time = Engine_time();
+    for(uint32_t i = 0; i < count; i++) {
+      struct Shield * s = &shield[i];
+      alias_R max = GameValue_get(&s->max);
+      alias_R delta = GameValue_get(&s->regen_per_second) + max * GameValue_get(&s->regen_percent_per_second);
 
-    shield->recharging = shield->live.current < GameValue_get(&shield->max)
-                      && Engine_time() > shield->live.last_damage_time + GameValue_get(&shield->recharge_delay)
-                       ;
+      s->recharging = s->live.current < max
+                   && time > s->live.last_damage_time + GameValue_get(&s->recharge_delay)
+                    ;
 
-    if(shield->recharging) {
-      delta += GameValue_get(&shield->recharge_per_second) + max * GameValue_get(&shield->recharge_percentage_per_second);
-    }
+      if(s->recharging) {
+        delta += GameValue_get(&s->recharge_per_second) + max * GameValue_get(&s->recharge_percentage_per_second);
+      }
 
-    LiveValue_update(&shield->live, delta, max);
+      LiveValue_update_at(&s->live, delta, max, frame_time, time);
+    }
   )
 )
-
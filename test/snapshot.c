@@ -0,0 +1,112 @@
+#include "../src/component.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// saves a handful of entities that reference each other, loads them into a new layer and checks the loaded copy. every
+// entity has its own set of components, so each is alone in its table and the load hands them back in save order.
+// the first one saved is row 0, references to it are the case a 0 based row would mistake for nothing.
+//
+//   a_cave_snapshot_test [snapshot path]
+#define TEST_NUM_SAVED 4
+
+static const char * _path = "snapshot_test.aws";
+static uint32_t _failures = 0;
+
+#define CHECK(CONDITION)                                                                \
+  do {                                                                                  \
+    if(!(CONDITION)) {                                                                  \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #CONDITION);    \
+      _failures++;                                                                      \
+    }                                                                                   \
+  } while(0)
+
+static bool _same_point(alias_pga2d_Point a, alias_pga2d_Point b) {
+  return alias_pga2d_point_x(a) == alias_pga2d_point_x(b) && alias_pga2d_point_y(a) == alias_pga2d_point_y(b);
+}
+
+static void _round_trip(void) {
+  alias_ecs_LayerHandle save_layer = Engine_create_layer(0);
+
+  Entity root = SPAWN_LAYER(save_layer
+    , ( alias_Translation2D, .value = alias_pga2d_point(1, 2) )
+    , ( alias_Rotation2D, .value = 3 )
+    );
+  Entity child = SPAWN_LAYER(save_layer
+    , ( alias_Translation2D, .value = alias_pga2d_point(4, 5) )
+    , ( alias_Parent2D, .value = root )
+    );
+  Entity player = SPAWN_LAYER(save_layer
+    , ( alias_Translation2D, .value = alias_pga2d_point(6, 7) )
+    , ( Movement, .target = MovementTarget_Entity, .target_entity = root, .movement_speed = 8 )
+    , ( PlayerControlMovement, .layer = save_layer, .player_index = 0, .target = child )
+    );
+  Entity outside = SPAWN_LAYER(save_layer, ( alias_Translation2D, .value = alias_pga2d_point(9, 10) ));
+  Entity orphan = SPAWN_LAYER(save_layer
+    , ( alias_Translation2D, .value = alias_pga2d_point(11, 12) )
+    , ( alias_Rotation2D, .value = 13 )
+    , ( alias_Parent2D, .value = outside )
+    );
+
+  Entity saved[TEST_NUM_SAVED] = { root, child, player, orphan };
+  CHECK(Engine_snapshot_save(_path, TEST_NUM_SAVED, saved));
+
+  alias_ecs_LayerHandle load_layer = Engine_create_layer(0);
+  uint32_t count = 0;
+  Entity * loaded = NULL;
+  CHECK(Engine_snapshot_load(_path, load_layer, &count, &loaded));
+  CHECK(count == TEST_NUM_SAVED);
+  if(count != TEST_NUM_SAVED) {
+    return;
+  }
+
+  // component data comes back as it was saved
+  for(uint32_t i = 0; i < TEST_NUM_SAVED; i++) {
+    CHECK(loaded[i] != saved[i]);
+    CHECK(_same_point(alias_Translation2D_read(loaded[i])->value, alias_Translation2D_read(saved[i])->value));
+  }
+  CHECK(alias_Rotation2D_read(loaded[0])->value == 3);
+  CHECK(alias_Rotation2D_read(loaded[3])->value == 13);
+  CHECK(Movement_read(loaded[2])->target == MovementTarget_Entity);
+  CHECK(Movement_read(loaded[2])->movement_speed == 8);
+
+  // references point at the loaded entities, one to an entity that was not saved points at nothing
+  CHECK(alias_Parent2D_read(loaded[1])->value == loaded[0]);
+  CHECK(alias_Parent2D_read(loaded[3])->value == ALIAS_ECS_INVALID_ENTITY);
+  CHECK(Movement_read(loaded[2])->target_entity == loaded[0]);
+
+  // init ran again for the loaded player, in the layer it was loaded into
+  const struct PlayerControlMovement * control = PlayerControlMovement_read(loaded[2]);
+  CHECK(control->target == loaded[1]);
+  CHECK(control->layer == load_layer);
+  CHECK(control->inputs != NULL);
+
+  Engine_destroy_layer(load_layer);
+  Engine_destroy_layer(save_layer);
+  remove(_path);
+}
+
+static void _test_frame(void * ud) {
+  (void)ud;
+  _round_trip();
+  Engine_pop_state();
+}
+
+static struct State _test_state = {
+  .frame = _test_frame
+};
+
+int main(int argc, char * argv[]) {
+  if(argc > 1) {
+    _path = argv[1];
+  }
+
+  Engine_init(640, 480, "a_cave_snapshot_test", &_test_state);
+  Engine_run();
+
+  if(_failures > 0) {
+    fprintf(stderr, "%u checks failed\n", _failures);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}